@@ -0,0 +1,90 @@
+#pragma once
+#include "simplex.hpp"
+#include <chrono>
+
+// helpers shared by the tableau solvers (simplex.cpp, mapped_tableau.cpp) and by
+// the drivers that split one budget over several solves
+
+template<class U> inline bool chmax(U& a, U b) {
+  if (a < b) {
+    a = b;
+    return true;
+  }
+  return false;
+}
+
+template<class U> inline bool chmin(U& a, U b) {
+  if (a > b) {
+    a = b;
+    return true;
+  }
+  return false;
+}
+
+// 一回の呼び出し(simplexMethod, subProblem, addRows, resume)の予算.
+// 反復回数は毎回, 中止と時間と進捗の報告はcheckEvery回のピボットごとに見る
+template <class T>
+class Budget {
+ public:
+  Budget(const SimplexOptions<T> &opt, const SimplexStats &stats)
+      : opt(opt), stats(stats), first(stats.iterations), start(std::chrono::steady_clock::now()) {}
+
+  // 次のピボットの前に呼ぶ. 続けてよければSOLVE_OPTIMAL.
+  // state(objective, infeasibility)は進捗を報告する時だけ呼ぶ
+  template <class State>
+  SolveStatus check(State state) const {
+    long done = stats.iterations - first;
+    if (opt.maxIterations > 0 && done >= opt.maxIterations) return SOLVE_ITERATION_LIMIT;
+    if (opt.checkEvery > 1 && done % opt.checkEvery != 0) return SOLVE_OPTIMAL;
+    if (opt.cancel && opt.cancel->cancelled()) return SOLVE_CANCELLED;
+    if (!opt.progress && opt.timeLimit <= 0) return SOLVE_OPTIMAL;
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (opt.progress) {
+      T objective = 0, infeasibility = 0;
+      state(objective, infeasibility);
+      SimplexProgress<T> progress = {done, objective, infeasibility, elapsed};
+      opt.progress(progress);
+    }
+    if (opt.timeLimit > 0 && elapsed >= opt.timeLimit) return SOLVE_TIME_LIMIT;
+    return SOLVE_OPTIMAL;
+  }
+
+  // 制約が[0, m)行, 目的関数がobj行, 右辺がrhs列の表
+  SolveStatus check(const BasicMatrix<T> &All, int m, int obj, int rhs) const {
+    return check([&All, m, obj, rhs](T &objective, T &infeasibility) {
+      // 第一段階(obj != m)は補助問題の値, それ以外は負の基底変数の和
+      if (obj != m) {
+        infeasibility = -All[obj][rhs];
+      } else {
+        for (int i = 0; i < m; i++) {
+          if (All[i][rhs] < 0) infeasibility -= All[i][rhs];
+        }
+      }
+      objective = All[m][rhs];
+    });
+  }
+
+ private:
+  const SimplexOptions<T> &opt;
+  const SimplexStats &stats;
+  long first;
+  std::chrono::steady_clock::time_point start;
+};
+
+// optの予算からstart以降の時間とiterations回のピボットを引いた残りをrestに入れる.
+// 使い切っていればSOLVE_ITERATION_LIMITかSOLVE_TIME_LIMIT
+template <class T>
+SolveStatus remainingBudget(const SimplexOptions<T> &opt, long iterations,
+                            std::chrono::steady_clock::time_point start, SimplexOptions<T> &rest) {
+  rest = opt;
+  if (opt.maxIterations > 0) {
+    if (iterations >= opt.maxIterations) return SOLVE_ITERATION_LIMIT;
+    rest.maxIterations = opt.maxIterations - iterations;
+  }
+  if (opt.timeLimit > 0) {
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (elapsed >= opt.timeLimit) return SOLVE_TIME_LIMIT;
+    rest.timeLimit = opt.timeLimit - elapsed;
+  }
+  return SOLVE_OPTIMAL;
+}
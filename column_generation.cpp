@@ -0,0 +1,87 @@
+#include "column_generation.hpp"
+
+template <class T>
+void addColumns(BasicMatrix<T> &All, Basis &basis, const std::vector<Column<T> > &columns) {
+  int m = All.getRow() - 1;
+  int n = All.getCol() - 1 - m;
+  int k = (int)columns.size();
+  if ((int)basis.size() != m) {
+    std::cout << "error: sizes do not match" << "\n";
+    std::abort();
+  }
+
+  // 今の基底で表した列: i行目は sum_l All[i][n+l] a_l (目的関数の行は -c を足す)
+  BasicMatrix<T> W(k, m+1);
+  for (int q = 0; q < k; q++) {
+    const BasicVector<T> &a = columns[q].a;
+    if (a.getSize() != m) {
+      std::cout << "error: sizes do not match" << "\n";
+      std::abort();
+    }
+    for (int i = 0; i < m+1; i++) {
+      const T *r = &All[i][n];
+      T v = 0;
+      for (int l = 0; l < m; l++) {
+        v += r[l] * a[l];
+      }
+      W[q][i] = v;
+    }
+    W[q][m] -= columns[q].c;
+  }
+
+  All.insertColumns(n, k);
+  for (int i = 0; i < m+1; i++) {
+    for (int q = 0; q < k; q++) {
+      All[i][n+q] = W[q][i];
+    }
+  }
+  for (int i = 0; i < m; i++) {
+    if (basis[i] >= n) basis[i] += k;
+  }
+}
+
+template <class T>
+SolveStatus columnGeneration(BasicMatrix<T> &All, Basis &basis, const PricingOracle<T> &price,
+                             const SimplexOptions<T> &opt, SimplexResult<T> *result,
+                             PricingStats *stats) {
+  SimplexResult<T> localResult;
+  SimplexResult<T> &r = result ? *result : localResult;
+  PricingStats localStats;
+  PricingStats &ps = stats ? *stats : localStats;
+  std::vector<Column<T> > columns;
+  while (true) {
+    SolveStatus status = simplexMethod(All, basis, opt, &r);
+    if (status != SOLVE_OPTIMAL) return status;
+
+    int m = All.getRow() - 1;
+    int n = All.getCol() - 1 - m;
+    BasicVector<T> y(&All[m][n], m);
+    columns.clear();
+    price(y, columns);
+    ps.rounds++;
+    if (columns.empty()) return SOLVE_OPTIMAL;
+
+    // 被約費用が負の列が一つもなければ, 今の解は返された列に対しても最適
+    bool improving = false;
+    for (size_t q = 0; q < columns.size(); q++) {
+      if (columns[q].c - columns[q].a * y > ScalarTraits<T>::nearlyZero()) improving = true;
+    }
+    if (!improving) return SOLVE_OPTIMAL;
+    addColumns(All, basis, columns);
+    ps.columns += (int)columns.size();
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                          explicit instantiation                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#define INSTANTIATE_COLUMN_GENERATION(T)                                       \
+  template void addColumns(BasicMatrix<T> &, Basis &, const std::vector<Column<T> > &); \
+  template SolveStatus columnGeneration(BasicMatrix<T> &, Basis &, const PricingOracle<T> &, \
+                                        const SimplexOptions<T> &, SimplexResult<T> *, \
+                                        PricingStats *);
+
+INSTANTIATE_COLUMN_GENERATION(float)
+INSTANTIATE_COLUMN_GENERATION(double)
+INSTANTIATE_COLUMN_GENERATION(long double)
@@ -0,0 +1,41 @@
+#pragma once
+#include "simplex.hpp"
+#include <functional>
+#include <vector>
+
+// column generation
+//
+// The tableau starts from a restricted set of columns of A. After every
+// re-optimization the pricing oracle gets the duals y and returns new columns
+// (a_j, c_j), ideally with c_j - y^Ta_j > 0. They are inserted in front of the
+// slack columns without rebuilding the tableau: the slack columns hold B^{-1}
+// and y, so the column in the current basis is B^{-1}a_j and its reduced cost
+// y^Ta_j - c_j. The solve then continues from the current basis. x_j of
+// getSolution is the j-th column ever added.
+
+// column a_j of A together with its cost c_j
+template <class T>
+struct Column {
+  BasicVector<T> a;             /* m */
+  T c;
+};
+
+// appends columns to the second argument; none means the duals are optimal
+template <class T>
+using PricingOracle = std::function<void(const BasicVector<T> &y, std::vector<Column<T> > &columns)>;
+
+struct PricingStats {
+  int rounds = 0;               /* calls of the pricing oracle */
+  int columns = 0;              /* columns added to the tableau */
+};
+
+// 列を元の変数の最後(スラック変数の前)に加え, 基底の添字をずらす. O((m+1)m)/列
+template <class T>
+void addColumns(BasicMatrix<T> &All, Basis &basis, const std::vector<Column<T> > &columns);
+
+// 単体法と価格付けを交互に行う. 価格付けが改善する列を返さなくなれば最適.
+// Allは実行可能な表(createMatrix / subProblemの結果)
+template <class T>
+SolveStatus columnGeneration(BasicMatrix<T> &All, Basis &basis, const PricingOracle<T> &price,
+                             const SimplexOptions<T> &opt, SimplexResult<T> *result = 0,
+                             PricingStats *stats = 0);
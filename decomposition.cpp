@@ -0,0 +1,288 @@
+#include "decomposition.hpp"
+#include "column_generation.hpp"
+#include "budget.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+typedef std::chrono::steady_clock Clock;
+
+static double microseconds(Clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+// 一回のdantzigWolfeの間だけ使うthreads-1個のスレッド. runは呼び出し側も含めた
+// 全員にworkを一度ずつ実行させ, 全員が終えてから戻る. 価格付けの回ごとに
+// スレッドを作り直さない
+class RoundPool {
+ public:
+  explicit RoundPool(int threads) {
+    for (int t = 1; t < threads; ++t) {
+      workers.push_back(std::thread(&RoundPool::loop, this));
+    }
+  }
+  ~RoundPool() {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (size_t t = 0; t < workers.size(); ++t) {
+      workers[t].join();
+    }
+  }
+  void run(const std::function<void()> &w) {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      work = &w;
+      round++;
+      busy = (int)workers.size();
+    }
+    wake.notify_all();
+    w();
+    std::unique_lock<std::mutex> guard(lock);
+    finished.wait(guard, [this]() { return busy == 0; });
+    work = 0;
+  }
+
+ private:
+  void loop() {
+    long seen = 0;
+    for (;;) {
+      const std::function<void()> *w;
+      {
+        std::unique_lock<std::mutex> guard(lock);
+        wake.wait(guard, [this, seen]() { return stopping || round != seen; });
+        if (stopping) return;
+        seen = round;
+        w = work;
+      }
+      (*w)();
+      std::lock_guard<std::mutex> guard(lock);
+      if (--busy == 0) finished.notify_all();
+    }
+  }
+  std::mutex lock;
+  std::condition_variable wake;
+  std::condition_variable finished;
+  const std::function<void()> *work = 0;
+  long round = 0;
+  int busy = 0;
+  bool stopping = false;
+  std::vector<std::thread> workers;
+};
+
+// ブロックの表(価格付けの回をまたいで持ち越す)と, その回の結果
+template <class T>
+struct BlockState {
+  BasicMatrix<T> All;
+  Basis basis;
+  bool built = false;
+  SolveStatus status = SOLVE_OPTIMAL;
+  bool ray = false;             /* pointは方向 */
+  BasicVector<T> point;         /* 最適な頂点か非有界な方向, n_k */
+  T profit = 0;                 /* (c_k - D_k^Ty)^T point */
+  long iterations = 0;
+};
+
+// 目的関数の行を費用costで基底basisについて計算し直す. 制約の行はそのままなので
+// 最適だった基底は主実行可能なまま. O(m(n+m))
+template <class T>
+static void setObjective(BasicMatrix<T> &All, const Basis &basis, const BasicVector<T> &cost) {
+  int m = All.getRow() - 1;
+  int n = All.getCol() - 1 - m;
+  T *obj = &All[m][0];
+  for (int j = 0; j <= n+m; j++) {
+    obj[j] = j < n ? -cost[j] : T(0);
+  }
+  for (int i = 0; i < m; i++) {
+    int j = basis[i];
+    if (j < 0 || j >= n || cost[j] == 0) continue;
+    T cb = cost[j];
+    const T *r = &All[i][0];
+    for (int l = 0; l <= n+m; l++) {
+      obj[l] += cb * r[l];
+    }
+  }
+  for (int i = 0; i < m; i++) {
+    if (basis[i] >= 0) obj[basis[i]] = 0;
+  }
+}
+
+// ブロックkを費用 c_k - D_k^Ty で解く. 初回は表を作り, 以後は前の回の基底から
+template <class T>
+static void solveBlock(const Block<T> &block, const BasicVector<T> &y, const SimplexOptions<T> &opt,
+                       BlockState<T> &s) {
+  int mk = block.b.getSize();
+  int n = block.c.getSize();
+  BasicVector<T> cost(block.c);
+  for (int i = 0; i < y.getSize(); i++) {
+    if (y[i] == 0) continue;
+    const T *r = &block.D[i][0];
+    for (int j = 0; j < n; j++) {
+      cost[j] -= y[i] * r[j];
+    }
+  }
+  if (!s.built) {
+    createMatrix(block.B, block.b, cost, s.basis).swap(s.All);
+    s.built = true;
+  } else {
+    setObjective(s.All, s.basis, cost);
+  }
+  SimplexResult<T> r;
+  s.status = simplexMethod(s.All, s.basis, opt, &r);
+  s.iterations += r.stats.iterations;
+  s.ray = s.status == SOLVE_UNBOUNDED;
+  s.point.setSize(n);
+  if (s.status == SOLVE_OPTIMAL) {
+    s.point = getSolution(s.All, s.basis).x;
+    s.profit = s.All[mk][n+mk];
+  } else if (s.ray) {
+    s.point = r.ray;
+    s.profit = cost * r.ray;
+  }
+}
+
+template <class T>
+DecompositionResult<T> dantzigWolfe(const std::vector<Block<T> > &blocks, const BasicVector<T> &d,
+                                    const DecompositionOptions<T> &opt) {
+  Clock::time_point start = Clock::now();
+  int K = (int)blocks.size();
+  int m0 = d.getSize();
+  for (int k = 0; k < K; k++) {
+    const Block<T> &block = blocks[k];
+    int n = block.c.getSize();
+    int mk = block.b.getSize();
+    // 空の行列は 0 x 0
+    if ((m0 > 0 && n > 0 && (block.D.getRow() != m0 || block.D.getCol() != n)) ||
+        (mk > 0 && n > 0 && (block.B.getRow() != mk || block.B.getCol() != n))) {
+      std::cout << "error: sizes do not match" << "\n";
+      std::abort();
+    }
+  }
+  int threads = opt.threads > 0 ? opt.threads : (int)std::thread::hardware_concurrency();
+  threads = std::max(1, std::min(threads, K));
+  DecompositionResult<T> res = {SOLVE_OPTIMAL, std::vector<BasicVector<T> >(), BasicVector<T>(m0), 0,
+                                std::numeric_limits<T>::infinity(), 0, 0, 0, 0, 0, 0};
+
+  // 主問題: 列のない表から始める(行は結合制約m0行と凸結合の行K行)
+  int M = m0 + K;
+  BasicVector<T> bM(M);
+  for (int i = 0; i < M; i++) {
+    bM[i] = i < m0 ? d[i] : T(1);
+  }
+  Basis basis;
+  BasicMatrix<T> All = createMatrix(BasicMatrix<T>(M, 0), bM, BasicVector<T>(0), basis);
+
+  // 主問題のj番目の列のブロックと頂点(方向)
+  std::vector<int> owner;
+  std::vector<BasicVector<T> > points;
+  std::vector<BlockState<T> > states(K);
+  SolveStatus stop = SOLVE_OPTIMAL;
+  RoundPool pool(threads);
+  SimplexResult<T> r;
+
+  PricingOracle<T> price = [&](const BasicVector<T> &y, std::vector<Column<T> > &columns) {
+    Clock::time_point round = Clock::now();
+    // ブロックはこの回までに主問題とブロックが使った残りの予算で解く.
+    // 進捗は主問題からだけ報告する(ブロックは別々のスレッドで解くので)
+    long spent = r.stats.iterations;
+    for (int k = 0; k < K; k++) {
+      spent += states[k].iterations;
+    }
+    SimplexOptions<T> blockOpt;
+    SolveStatus status = remainingBudget(opt.lp, spent, start, blockOpt);
+    if (status != SOLVE_OPTIMAL) {
+      stop = status;
+      return;
+    }
+    blockOpt.progress = nullptr;
+    BasicVector<T> yc(&y[0], m0);
+    std::atomic<int> next(0);
+    pool.run([&]() {
+      for (int k = next++; k < K; k = next++) {
+        solveBlock(blocks[k], yc, blockOpt, states[k]);
+      }
+    });
+    res.rounds++;
+
+    // 上界 y^Td + sum_k max (c_k - D_k^Ty)^Tx と主問題の値 y^Td + sum_k mu_k
+    T yd = 0, f = 0, bound = 0;
+    bool ray = false;
+    for (int i = 0; i < m0; i++) {
+      yd += yc[i] * d[i];
+    }
+    f = yd;
+    bound = yd;
+    for (int k = 0; k < K; k++) {
+      const BlockState<T> &s = states[k];
+      if (s.status != SOLVE_OPTIMAL && s.status != SOLVE_UNBOUNDED) {
+        stop = s.status;
+        res.pricingTime += microseconds(round);
+        return;
+      }
+      if (s.ray) ray = true;
+      else bound += s.profit;
+      f += y[m0+k];
+    }
+    res.bound = ray ? std::numeric_limits<T>::infinity() : bound;
+    if (!ray && bound - f <= opt.gap * (1 + std::fabs(f))) {
+      res.pricingTime += microseconds(round);
+      return;
+    }
+
+    // 被約利益が正のブロックの頂点(方向)を列にする
+    for (int k = 0; k < K; k++) {
+      const BlockState<T> &s = states[k];
+      if (!s.ray && s.profit - y[m0+k] <= ScalarTraits<T>::nearlyZero()) continue;
+      const Block<T> &block = blocks[k];
+      Column<T> col = {BasicVector<T>(M), block.c * s.point};
+      for (int i = 0; i < m0; i++) {
+        col.a[i] = block.D[i] * s.point;
+      }
+      if (!s.ray) col.a[m0+k] = 1;
+      columns.push_back(col);
+      owner.push_back(k);
+      points.push_back(s.point);
+    }
+    res.columns += (int)columns.size();
+    res.pricingTime += microseconds(round);
+  };
+
+  res.status = columnGeneration(All, basis, price, opt.lp, &r);
+  if (res.status == SOLVE_OPTIMAL && stop != SOLVE_OPTIMAL) res.status = stop;
+  res.masterIterations = r.stats.iterations;
+  for (int k = 0; k < K; k++) {
+    res.blockIterations += states[k].iterations;
+    res.x.push_back(BasicVector<T>(blocks[k].c.getSize()));
+  }
+  if (res.status == SOLVE_OPTIMAL) {
+    Solution<T> sol = getSolution(All, basis);
+    for (size_t j = 0; j < owner.size(); j++) {
+      if (sol.x[j] != 0) res.x[owner[j]] += sol.x[j] * points[j];
+    }
+    for (int i = 0; i < m0; i++) {
+      res.y[i] = sol.dual[i];
+    }
+    res.f = sol.f;
+  }
+  res.masterTime = microseconds(start) - res.pricingTime;
+  return res;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                          explicit instantiation                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#define INSTANTIATE_DECOMPOSITION(T)                                           \
+  template DecompositionResult<T> dantzigWolfe(const std::vector<Block<T> > &, const BasicVector<T> &, \
+                                               const DecompositionOptions<T> &);
+
+INSTANTIATE_DECOMPOSITION(float)
+INSTANTIATE_DECOMPOSITION(double)
+INSTANTIATE_DECOMPOSITION(long double)
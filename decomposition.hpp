@@ -0,0 +1,72 @@
+#pragma once
+#include "simplex.hpp"
+#include <vector>
+
+// Dantzig-Wolfe decomposition of a block-angular LP
+//
+//   maximize   sum_k c_k^Tx_k
+//   s.t.       sum_k D_k x_k \leq d      (m0 coupling rows)
+//              B_k x_k \leq b_k          (rows of block k alone)
+//              x_k \geq 0
+//
+// Every point of P_k = {B_k x \leq b_k, x \geq 0} is a convex combination of
+// its vertices plus a nonnegative combination of its rays. The restricted
+// master has, per generated vertex v of block k, a column (D_k v, e_k) with
+// cost c_k^Tv, per generated ray r a column (D_k r, 0) with cost c_k^Tr, the
+// coupling rows \leq d and one convexity row sum \lambda \leq 1 per block.
+// b_k \geq 0 makes the origin a vertex of every block, so the convexity rows
+// may be inequalities, and d \geq 0 lets the master start from its slack
+// basis with no column at all.
+//
+// The master is solved with columnGeneration. Its pricing oracle gets the
+// duals (y, mu) and solves every block for the costs c_k - D_k^Ty on a pool
+// of threads that lives for the whole solve. Each block keeps its own tableau from round to round: only the
+// objective row is recomputed in the last optimal basis, which stays primal
+// feasible, so a round costs a few warm pivots per block. A block whose best
+// vertex v has (c_k - D_k^Ty)^Tv > mu_k (or that is unbounded along a ray)
+// adds that column. y^Td + sum_k max_{P_k} (c_k - D_k^Ty)^Tx bounds the
+// optimum from above; generation stops once no block has a positive reduced
+// profit or the bound is within gap of the master.
+
+template <class T>
+struct Block {
+  BasicMatrix<T> D;             /* coupling rows, m0 x n_k */
+  BasicMatrix<T> B;             /* rows of the block, m_k x n_k */
+  BasicVector<T> b;             /* m_k, \geq 0 */
+  BasicVector<T> c;             /* n_k */
+};
+
+template <class T>
+struct DecompositionOptions {
+  int threads = 0;              /* 0: std::thread::hardware_concurrency() */
+  T gap = ScalarTraits<T>::nearlyZero(); /* stop once bound - f \leq gap (1 + |f|) */
+  // options of the master and of every block solve. maxIterations and timeLimit
+  // count from the start of dantzigWolfe: each pricing round gives its block
+  // solves what the master and the blocks have left (every block of the round
+  // may use all of it), and no round starts once it is used up. Each master
+  // re-solve of columnGeneration still gets the whole limits. progress is
+  // reported by the master only, since the blocks are solved on the pool
+  SimplexOptions<T> lp;
+};
+
+template <class T>
+struct DecompositionResult {
+  // SOLVE_OPTIMAL, SOLVE_UNBOUNDED (the master along generated rays), or the
+  // status of a master or block solve stopped by the limits or the token of opt.lp
+  SolveStatus status;
+  std::vector<BasicVector<T> > x; /* per block, n_k */
+  BasicVector<T> y;             /* duals of the coupling rows, m0 */
+  T f;                          /* sum_k c_k^Tx_k */
+  T bound;                      /* upper bound of the last pricing round */
+  int rounds;                   /* pricing rounds */
+  int columns;                  /* master columns generated (vertices and rays) */
+  long masterIterations;        /* pivots of the master */
+  long blockIterations;         /* pivots of all block solves */
+  double masterTime;            /* [μs] */
+  double pricingTime;           /* [μs] wall time of the pricing rounds */
+};
+
+// b_k \geq 0 and d \geq 0 (the origin is feasible); sizes must agree
+template <class T>
+DecompositionResult<T> dantzigWolfe(const std::vector<Block<T> > &blocks, const BasicVector<T> &d,
+                                    const DecompositionOptions<T> &opt = DecompositionOptions<T>());
@@ -0,0 +1,259 @@
+#pragma once
+#include "simplex.hpp"
+#include <array>
+#include <limits>
+#include <utility>
+
+// simplex method for tiny problems whose size is known at compile time
+//
+// The (M+1) x (N+M+1) tableau lives in a std::array on the stack, every loop
+// has a compile-time trip count and all routines are constexpr, so
+//   constexpr FixedResult<2, double> r = fixedSolve<2, 2>(A, b, c);
+// is solved by the compiler. Only the all-slack start is supported (b \geq 0).
+
+// loops with compile-time trip counts are unrolled completely
+#if defined(__clang__)
+#define FIXED_UNROLL _Pragma("unroll")
+#elif defined(__GNUC__)
+#define FIXED_UNROLL _Pragma("GCC unroll 64")
+#else
+#define FIXED_UNROLL
+#endif
+
+// sizes routed to the fixed solver by solveLP
+#define FIXED_MAX_M 6
+#define FIXED_MAX_N 6
+
+enum FixedStatus {
+  FIXED_OPTIMAL,
+  FIXED_UNBOUNDED,
+  FIXED_NEEDS_PHASE1            /* some b_i < 0, use subProblem instead */
+};
+
+template <int M, int N, class T = double>
+struct FixedTableau {
+  static const int Rows = M + 1;
+  static const int Cols = N + M + 1;
+  std::array<T, Rows * Cols> a{};
+  std::array<int, M> basis{};   /* basis[i]: column basic in row i */
+  constexpr T &at(int i, int j) { return a[i * Cols + j]; }
+  constexpr const T &at(int i, int j) const { return a[i * Cols + j]; }
+};
+
+template <int N, class T = double>
+struct FixedResult {
+  FixedStatus status = FIXED_OPTIMAL;
+  T f = 0;
+  std::array<T, N> x{};
+  int iterations = 0;
+};
+
+// 2^-(5/8 (digits-1)), the constexpr counterpart of ScalarTraits<T>::nearlyZero
+template <class T>
+constexpr T fixedTolerance() {
+  T tol = 1;
+  for (int k = 0; k < 5 * (std::numeric_limits<T>::digits - 1) / 8; ++k) {
+    tol /= 2;
+  }
+  return tol;
+}
+
+template <class T>
+constexpr T fixedAbs(T v) { return v < 0 ? -v : v; }
+
+// 入力行列を作る (createMatrixと同じ形)
+template <int M, int N, class T>
+constexpr FixedTableau<M, N, T> fixedCreateMatrix(const std::array<std::array<T, N>, M> &A,
+                                                  const std::array<T, M> &b,
+                                                  const std::array<T, N> &c) {
+  typedef FixedTableau<M, N, T> Tab;
+  Tab t{};
+  FIXED_UNROLL
+  for (int i = 0; i < M; ++i) {
+    FIXED_UNROLL
+    for (int j = 0; j < N; ++j) {
+      t.at(i, j) = A[i][j];
+    }
+    t.at(i, N + i) = 1;
+    t.at(i, Tab::Cols - 1) = b[i];
+    t.basis[i] = N + i;
+  }
+  FIXED_UNROLL
+  for (int j = 0; j < N; ++j) {
+    t.at(M, j) = -c[j];
+  }
+  return t;
+}
+
+// 以下の行, 列をピボットにして掃き出しを行う
+template <int M, int N, class T>
+constexpr void fixedPivot(FixedTableau<M, N, T> &t, int ROW, int COL) {
+  typedef FixedTableau<M, N, T> Tab;
+  T p = t.at(ROW, COL);
+  FIXED_UNROLL
+  for (int j = 0; j < Tab::Cols; ++j) {
+    t.at(ROW, j) /= p;
+  }
+  FIXED_UNROLL
+  for (int i = 0; i < Tab::Rows; ++i) {
+    if (i == ROW) continue;
+    T d = t.at(i, COL);
+    FIXED_UNROLL
+    for (int j = 0; j < Tab::Cols; ++j) {
+      t.at(i, j) -= d * t.at(ROW, j);
+    }
+  }
+  t.basis[ROW] = COL;
+}
+
+// 最大係数規則で始め, 退化したピボットの後はブランドの規則に切り替える
+template <int M, int N, class T>
+constexpr FixedResult<N, T> fixedSimplex(FixedTableau<M, N, T> &t) {
+  typedef FixedTableau<M, N, T> Tab;
+  const T tol = fixedTolerance<T>();
+  FixedResult<N, T> r{};
+  FIXED_UNROLL
+  for (int i = 0; i < M; ++i) {
+    if (t.at(i, Tab::Cols - 1) < 0) {
+      r.status = FIXED_NEEDS_PHASE1;
+      return r;
+    }
+  }
+
+  bool bland = false;
+  while (true) {
+    int SI = -1;
+    T S = -tol;
+    FIXED_UNROLL
+    for (int j = 0; j < N + M; ++j) {
+      if (t.at(M, j) < S) {
+        S = t.at(M, j);
+        SI = j;
+        if (bland) break;
+      }
+    }
+    if (SI == -1) break;
+
+    int PI = -1;
+    T P = 0;
+    FIXED_UNROLL
+    for (int i = 0; i < M; ++i) {
+      T a = t.at(i, SI);
+      if (a > tol) {
+        T ratio = t.at(i, Tab::Cols - 1) / a;
+        if (PI == -1 || ratio < P || (bland && ratio == P && t.basis[i] < t.basis[PI])) {
+          P = ratio;
+          PI = i;
+        }
+      }
+    }
+    if (PI == -1) {
+      r.status = FIXED_UNBOUNDED;
+      return r;
+    }
+    if (fixedAbs(P) <= tol) bland = true;
+    fixedPivot(t, PI, SI);
+    ++r.iterations;
+  }
+
+  FIXED_UNROLL
+  for (int i = 0; i < M; ++i) {
+    if (t.basis[i] < N) r.x[t.basis[i]] = t.at(i, Tab::Cols - 1);
+  }
+  r.f = t.at(M, Tab::Cols - 1);
+  return r;
+}
+
+template <int M, int N, class T>
+constexpr FixedResult<N, T> fixedSolve(const std::array<std::array<T, N>, M> &A,
+                                       const std::array<T, M> &b,
+                                       const std::array<T, N> &c) {
+  FixedTableau<M, N, T> t = fixedCreateMatrix<M, N, T>(A, b, c);
+  return fixedSimplex(t);
+}
+
+// runtime entry of one compile-time size
+template <int M, int N, class T>
+FixedStatus fixedSolveRuntime(const BasicMatrix<T> &A, const BasicVector<T> &b,
+                              const BasicVector<T> &c, BasicVector<T> &x, T &f) {
+  std::array<std::array<T, N>, M> a;
+  std::array<T, M> bb;
+  std::array<T, N> cc;
+  FIXED_UNROLL
+  for (int i = 0; i < M; ++i) {
+    FIXED_UNROLL
+    for (int j = 0; j < N; ++j) {
+      a[i][j] = A[i][j];
+    }
+    bb[i] = b[i];
+  }
+  FIXED_UNROLL
+  for (int j = 0; j < N; ++j) {
+    cc[j] = c[j];
+  }
+  FixedResult<N, T> r = fixedSolve<M, N, T>(a, bb, cc);
+  if (r.status == FIXED_OPTIMAL) {
+    FIXED_UNROLL
+    for (int j = 0; j < N; ++j) {
+      x[j] = r.x[j];
+    }
+    f = r.f;
+  }
+  return r.status;
+}
+
+// table of fixedSolveRuntime<M, N> for 1 \leq M, N \leq FIXED_MAX
+template <class T>
+struct FixedDispatch {
+  typedef FixedStatus (*Entry)(const BasicMatrix<T> &, const BasicVector<T> &,
+                               const BasicVector<T> &, BasicVector<T> &, T &);
+
+  template <int... K>
+  static const Entry *table(std::integer_sequence<int, K...>) {
+    static const Entry entries[] = {
+      &fixedSolveRuntime<K / FIXED_MAX_N + 1, K % FIXED_MAX_N + 1, T>...};
+    return entries;
+  }
+
+  static Entry get(int m, int n) {
+    static const Entry *entries =
+        table(std::make_integer_sequence<int, FIXED_MAX_M * FIXED_MAX_N>());
+    return entries[(m - 1) * FIXED_MAX_N + (n - 1)];
+  }
+};
+
+// maximize c^Tx s.t. Ax \leq b and x \geq 0, x and f = c^Tx are written back.
+// Sizes up to FIXED_MAX_M x FIXED_MAX_N with b \geq 0 run on the stack,
+// everything else on the createMatrix / subProblem tableau.
+// x and f are only written for SOLVE_OPTIMAL
+template <class T>
+SolveStatus solveLP(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+             BasicVector<T> &x, T &f) {
+  int m = b.getSize();
+  int n = c.getSize();
+  if (x.getSize() != n) x.setSize(n);
+  if (m >= 1 && m <= FIXED_MAX_M && n >= 1 && n <= FIXED_MAX_N) {
+    FixedStatus status = FixedDispatch<T>::get(m, n)(A, b, c, x, f);
+    if (status == FIXED_OPTIMAL) return SOLVE_OPTIMAL;
+    if (status == FIXED_UNBOUNDED) return SOLVE_UNBOUNDED;
+  }
+
+  bool nonnegative_b = true;
+  for (int i = 0; i < m; i++) {
+    if (b[i] < 0) nonnegative_b = false;
+  }
+  Basis basis;
+  BasicMatrix<T> All;
+  if (nonnegative_b) {
+    createMatrix(A, b, c, basis).swap(All);
+  } else {
+    SolveStatus status = subProblem(A, b, c, All, basis);
+    if (status != SOLVE_OPTIMAL) return status;
+  }
+  SolveStatus status = simplexMethod(All, basis);
+  if (status != SOLVE_OPTIMAL) return status;
+  Solution<T> sol = getSolution(All, basis);
+  x = sol.x;
+  f = sol.f;
+  return SOLVE_OPTIMAL;
+}
@@ -0,0 +1,263 @@
+#include "interior_point.hpp"
+#include <algorithm>
+#include <vector>
+
+#define IPM_MAX_ITERATIONS 200
+// fraction of the distance to the boundary taken by a step
+#define IPM_STEP 0.99
+
+// y = Ax
+template <class T>
+static void multiply(const BasicMatrix<T> &A, const BasicVector<T> &x, BasicVector<T> &y) {
+  for (int i = 0; i < A.getRow(); i++) {
+    y[i] = A[i] * x;
+  }
+}
+
+// y = A^Tx
+template <class T>
+static void multiplyT(const BasicMatrix<T> &A, const BasicVector<T> &x, BasicVector<T> &y) {
+  int n = A.getCol();
+  for (int j = 0; j < n; j++) {
+    y[j] = 0;
+  }
+  for (int i = 0; i < A.getRow(); i++) {
+    if (x[i] == 0) continue;
+    const T *row = &A[i][0];
+    T xi = x[i];
+    for (int j = 0; j < n; j++) {
+      y[j] += xi * row[j];
+    }
+  }
+}
+
+// largest alpha \leq 1 with v + alpha dv \geq 0
+template <class T>
+static T maxStep(const BasicVector<T> &v, const BasicVector<T> &dv) {
+  T alpha = 1;
+  for (int i = 0; i < v.getSize(); i++) {
+    if (dv[i] < 0) alpha = std::min(alpha, -v[i] / dv[i]);
+  }
+  return alpha;
+}
+
+// Newton system of one iteration, reduced to the normal equations
+//   (A D A^T + E) dy = A D r1 - r2         (m \leq n)
+//   (D^-1 + A^T E^-1 A) dx = r1 + A^T E^-1 r2   (m > n)
+// with D = X/Z, E = S/Y, r1 = rd + rxz/x and r2 = rp - rsy/y
+template <class T>
+class NormalEquations {
+ public:
+  NormalEquations(const BasicMatrix<T> &A)
+      : A(A), m(A.getRow()), n(A.getCol()), rows(m <= n),
+        D(n), E(m), L(rows ? m : n, rows ? m : n) {}
+
+  void factor(const BasicVector<T> &x, const BasicVector<T> &s,
+              const BasicVector<T> &y, const BasicVector<T> &z) {
+    for (int j = 0; j < n; j++) D[j] = x[j] / z[j];
+    for (int i = 0; i < m; i++) E[i] = s[i] / y[i];
+    if (rows) {
+      BasicVector<T> w(n);
+      for (int i = 0; i < m; i++) {
+        const T *ai = &A[i][0];
+        for (int j = 0; j < n; j++) w[j] = ai[j] * D[j];
+        for (int k = 0; k <= i; k++) L[i][k] = w * A[k];
+        L[i][i] += E[i];
+      }
+    } else {
+      for (int j = 0; j < n; j++) {
+        for (int l = 0; l <= j; l++) L[j][l] = 0;
+        L[j][j] = 1 / D[j];
+      }
+      for (int i = 0; i < m; i++) {
+        const T *ai = &A[i][0];
+        T e = 1 / E[i];
+        for (int j = 0; j < n; j++) {
+          T t = e * ai[j];
+          if (t == 0) continue;
+          T *lj = &L[j][0];
+          for (int l = 0; l <= j; l++) lj[l] += t * ai[l];
+        }
+      }
+    }
+    cholesky(L);
+  }
+
+  void solve(const BasicVector<T> &x, const BasicVector<T> &s,
+             const BasicVector<T> &y, const BasicVector<T> &z,
+             const BasicVector<T> &rp, const BasicVector<T> &rd,
+             const BasicVector<T> &rxz, const BasicVector<T> &rsy,
+             BasicVector<T> &dx, BasicVector<T> &ds,
+             BasicVector<T> &dy, BasicVector<T> &dz) {
+    BasicVector<T> r1(n), r2(m);
+    for (int j = 0; j < n; j++) r1[j] = rd[j] + rxz[j] / x[j];
+    for (int i = 0; i < m; i++) r2[i] = rp[i] - rsy[i] / y[i];
+    if (rows) {
+      BasicVector<T> t(n);
+      for (int j = 0; j < n; j++) t[j] = D[j] * r1[j];
+      multiply(A, t, dy);
+      dy -= r2;
+      choleskySolve(L, dy);
+      multiplyT(A, dy, t);
+      for (int j = 0; j < n; j++) dx[j] = D[j] * (r1[j] - t[j]);
+    } else {
+      BasicVector<T> t(m);
+      for (int i = 0; i < m; i++) t[i] = r2[i] / E[i];
+      multiplyT(A, t, dx);
+      dx += r1;
+      choleskySolve(L, dx);
+      multiply(A, dx, dy);
+      for (int i = 0; i < m; i++) dy[i] = (dy[i] - r2[i]) / E[i];
+    }
+    for (int j = 0; j < n; j++) dz[j] = (rxz[j] - z[j] * dx[j]) / x[j];
+    for (int i = 0; i < m; i++) ds[i] = (rsy[i] - s[i] * dy[i]) / y[i];
+  }
+
+ private:
+  const BasicMatrix<T> &A;
+  int m, n;
+  bool rows;
+  BasicVector<T> D, E;
+  BasicMatrix<T> L;
+};
+
+template <class T>
+IPMResult<T> interiorPointMethod(const BasicMatrix<T> &A, const BasicVector<T> &b,
+                                 const BasicVector<T> &c) {
+  int m = b.getSize();
+  int n = c.getSize();
+  const T tol = std::sqrt(std::numeric_limits<T>::epsilon());
+  // iterates this large mean that the primal (or dual) has no solution
+  const T huge = (1 + b.norm() + c.norm()) / ScalarTraits<T>::nearlyZero();
+
+  IPMResult<T> r = {SOLVE_OPTIMAL, BasicVector<T>(n), BasicVector<T>(m), BasicVector<T>(m),
+                    BasicVector<T>(n), 0, 0};
+  BasicVector<T> &x = r.x, &s = r.s, &y = r.y, &z = r.z;
+  for (int j = 0; j < n; j++) x[j] = z[j] = 1;
+  for (int i = 0; i < m; i++) s[i] = y[i] = 1;
+
+  NormalEquations<T> K(A);
+  BasicVector<T> rp(m), rd(n), rxz(n), rsy(m), t(n);
+  BasicVector<T> dx(n), ds(m), dy(m), dz(n);
+  BasicVector<T> cx(n), cs(m), cy(m), cz(n);
+  for (r.iterations = 0; ; r.iterations++) {
+    // 残差
+    multiply(A, x, rp);
+    for (int i = 0; i < m; i++) rp[i] = b[i] - rp[i] - s[i];
+    multiplyT(A, y, t);
+    for (int j = 0; j < n; j++) rd[j] = c[j] - t[j] + z[j];
+    T mu = (x * z + s * y) / (n + m);
+    T pobj = c * x;
+    T dobj = b * y;
+    if (rp.norm() <= tol * (1 + b.norm()) && rd.norm() <= tol * (1 + c.norm()) &&
+        std::fabs(pobj - dobj) <= tol * (1 + std::fabs(pobj))) {
+      break;
+    }
+    if (std::sqrt(y * y + z * z) > huge) r.status = SOLVE_INFEASIBLE;
+    else if (std::sqrt(x * x + s * s) > huge) r.status = SOLVE_UNBOUNDED;
+    else if (r.iterations == IPM_MAX_ITERATIONS) r.status = SOLVE_ITERATION_LIMIT;
+    if (r.status != SOLVE_OPTIMAL) break;
+
+    K.factor(x, s, y, z);
+
+    // 予測子 (affine scaling)
+    for (int j = 0; j < n; j++) rxz[j] = -x[j] * z[j];
+    for (int i = 0; i < m; i++) rsy[i] = -s[i] * y[i];
+    K.solve(x, s, y, z, rp, rd, rxz, rsy, dx, ds, dy, dz);
+    T ap = std::min(maxStep(x, dx), maxStep(s, ds));
+    T ad = std::min(maxStep(y, dy), maxStep(z, dz));
+    T muaff = 0;
+    for (int j = 0; j < n; j++) muaff += (x[j] + ap * dx[j]) * (z[j] + ad * dz[j]);
+    for (int i = 0; i < m; i++) muaff += (s[i] + ap * ds[i]) * (y[i] + ad * dy[i]);
+    muaff /= (n + m);
+    T sigma = std::pow(muaff / mu, 3);
+
+    // 修正子 (centering + second order term)
+    for (int j = 0; j < n; j++) rxz[j] = sigma * mu - x[j] * z[j] - dx[j] * dz[j];
+    for (int i = 0; i < m; i++) rsy[i] = sigma * mu - s[i] * y[i] - ds[i] * dy[i];
+    K.solve(x, s, y, z, rp, rd, rxz, rsy, cx, cs, cy, cz);
+    ap = std::min((T)1, (T)IPM_STEP * std::min(maxStep(x, cx), maxStep(s, cs)));
+    ad = std::min((T)1, (T)IPM_STEP * std::min(maxStep(y, cy), maxStep(z, cz)));
+    for (int j = 0; j < n; j++) {
+      x[j] += ap * cx[j];
+      z[j] += ad * cz[j];
+    }
+    for (int i = 0; i < m; i++) {
+      s[i] += ap * cs[i];
+      y[i] += ad * cy[i];
+    }
+  }
+  r.f = c * x;
+  return r;
+}
+
+template <class T>
+SolveStatus crossover(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                      const IPMResult<T> &ipm, BasicMatrix<T> &All) {
+  Basis basis;
+  return crossover(A, b, c, ipm, All, basis);
+}
+
+template <class T>
+SolveStatus crossover(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                      const IPMResult<T> &ipm, BasicMatrix<T> &All, Basis &basis) {
+  if (ipm.status != SOLVE_OPTIMAL) return ipm.status;
+  int m = b.getSize();
+  int n = c.getSize();
+  // 作った表と入れ替える(コピーも確保もしない)
+  createMatrix(A, b, c, basis).swap(All);
+
+  // x_j > z_j の列を値の大きい順に基底に入れる
+  std::vector<int> order;
+  for (int j = 0; j < n; j++) {
+    if (ipm.x[j] > ipm.z[j]) order.push_back(j);
+  }
+  std::sort(order.begin(), order.end(),
+            [&](int p, int q) { return ipm.x[p] > ipm.x[q]; });
+
+  for (size_t k = 0; k < order.size(); k++) {
+    int j = order[k];
+    // 出ていくのはスラックが基底にある行, なるべく s_i \leq y_i (等号で効いている制約)
+    T amax = 0;
+    for (int i = 0; i < m; i++) {
+      if (basis[i] >= n) amax = std::max(amax, std::fabs(All[i][j]));
+    }
+    if (amax <= ScalarTraits<T>::nearlyZero()) continue;
+    int row = -1;
+    bool tight = false;
+    T best = 0;
+    for (int i = 0; i < m; i++) {
+      if (basis[i] < n) continue;
+      T a = std::fabs(All[i][j]);
+      if (a < 0.1 * amax) continue;
+      bool t = ipm.s[basis[i] - n] <= ipm.y[basis[i] - n];
+      if (row == -1 || (t && !tight) || (t == tight && a > best)) {
+        row = i;
+        tight = t;
+        best = a;
+      }
+    }
+    pivot(All, row, j);
+    basis[row] = j;
+  }
+
+  // 負になった基底の値はsimplexMethodが実行可能に戻してから解く
+  return simplexMethod(All, basis);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                          explicit instantiation                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#define INSTANTIATE_INTERIOR_POINT(T)                                          \
+  template IPMResult<T> interiorPointMethod(const BasicMatrix<T> &, const BasicVector<T> &, \
+                                            const BasicVector<T> &);           \
+  template SolveStatus crossover(const BasicMatrix<T> &, const BasicVector<T> &, \
+                                 const BasicVector<T> &, const IPMResult<T> &, BasicMatrix<T> &); \
+  template SolveStatus crossover(const BasicMatrix<T> &, const BasicVector<T> &, \
+                                 const BasicVector<T> &, const IPMResult<T> &, BasicMatrix<T> &, \
+                                 Basis &);
+
+INSTANTIATE_INTERIOR_POINT(float)
+INSTANTIATE_INTERIOR_POINT(double)
+INSTANTIATE_INTERIOR_POINT(long double)
@@ -0,0 +1,37 @@
+#pragma once
+#include "simplex.hpp"
+
+// primal-dual interior point method (Mehrotra predictor-corrector)
+//
+// maximize c^Tx s.t. Ax + s = b, x, s \geq 0 together with its dual
+// minimize b^Ty s.t. A^Ty - z = c, y, z \geq 0. Each iteration solves the
+// normal equations with a Cholesky factor of an m x m or an n x n matrix,
+// whichever is smaller, so tall problems never build an (m+1) x (n+m+1)
+// tableau.
+
+template <class T>
+struct IPMResult {
+  SolveStatus status;           /* SOLVE_INFEASIBLE / SOLVE_UNBOUNDED when the iterates diverge */
+  BasicVector<T> x;             /* primal */
+  BasicVector<T> s;             /* slack of Ax \leq b */
+  BasicVector<T> y;             /* dual price of each row */
+  BasicVector<T> z;             /* reduced cost of each column */
+  T f;                          /* c^Tx */
+  int iterations;
+};
+
+// 反復がIPM_MAX_ITERATIONSに達したらSOLVE_ITERATION_LIMIT
+template <class T>
+IPMResult<T> interiorPointMethod(const BasicMatrix<T> &A, const BasicVector<T> &b,
+                                 const BasicVector<T> &c);
+
+// 内点法の解から基底解を作り, 単体法で仕上げた最終表をAllに作る. 表は
+// createMatrixと同じ大きさで, 一回のピボットは単体法と同じO(m(n+m)).
+// 小さな問題では単体法だけの方が速い. 基底や最終表が要る時のためのもの
+template <class T>
+SolveStatus crossover(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                      const IPMResult<T> &ipm, BasicMatrix<T> &All);
+
+template <class T>
+SolveStatus crossover(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                      const IPMResult<T> &ipm, BasicMatrix<T> &All, Basis &basis);
@@ -0,0 +1,236 @@
+// load generator for lp_server
+//
+// Opens --connections connections, each sending --jobs random feasible bounded
+// LPs (0 \leq A, b = 0.5 * row sums, every fourth with an extra row with
+// negative b so that the server runs phase 1) with up to --window jobs in
+// flight. Every optimal result is checked against its problem; a solve stopped
+// by the server's --time-limit is counted apart. Prints the throughput,
+// the client-side latency and the server's metrics.
+//
+// usage: lp_client [--socket path] [--connections k] [--jobs k] [--m k] [--n k]
+//                  [--window k] [--seed s]
+
+#include "simplex.hpp"
+#include "lp_protocol.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using std::cout;
+using std::endl;
+typedef std::chrono::steady_clock Clock;
+
+struct ClientOptions {
+  std::string socket = "/tmp/lp_server.sock";
+  int connections = 4;
+  int jobs = 200;               /* per connection */
+  int m = 40;                   /* sizes are drawn from [m/2, m] x [n/2, n] */
+  int n = 40;
+  int window = 8;               /* jobs in flight per connection */
+  unsigned seed = 1;
+};
+
+// 送った問題(結果の確認用)
+struct Sent {
+  int m, n;
+  std::vector<double> data;     /* A, b, c */
+  Clock::time_point time;
+};
+
+struct Totals {
+  std::mutex mutex;
+  long jobs = 0;
+  long failed = 0;
+  long rejected = 0;
+  long stopped = 0;
+  long iterations = 0;
+  double queueTime = 0;
+  double solveTime = 0;
+  double chunk = 0;
+  std::vector<double> latencies;
+};
+
+static int connectTo(const std::string &path) {
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (fd < 0 || path.size() >= sizeof(addr.sun_path)) return -1;
+  std::strcpy(addr.sun_path, path.c_str());
+  if (::connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0) {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static Sent generate(std::mt19937 &mt, const ClientOptions &opt, bool negative) {
+  std::uniform_real_distribution<double> uniform(0, 1);
+  Sent s;
+  s.m = opt.m / 2 + (int)(mt() % (opt.m - opt.m / 2 + 1));
+  s.n = opt.n / 2 + (int)(mt() % (opt.n - opt.n / 2 + 1));
+  int rows = s.m + (negative ? 1 : 0);
+  s.data.assign((size_t)rows * s.n + rows + s.n, 0);
+  double *A = &s.data[0], *b = A + (size_t)rows * s.n, *c = b + rows;
+  for (int i = 0; i < s.m; i++) {
+    for (int j = 0; j < s.n; j++) {
+      A[i * s.n + j] = uniform(mt);
+      b[i] += 0.5 * A[i * s.n + j];
+    }
+  }
+  // -sum x_j \leq -0.1 (x = 0.5 が満たす)
+  if (negative) {
+    for (int j = 0; j < s.n; j++) A[s.m * s.n + j] = -1;
+    b[s.m] = -0.1;
+  }
+  for (int j = 0; j < s.n; j++) c[j] = uniform(mt);
+  s.m = rows;
+  return s;
+}
+
+// x \geq 0, Ax \leq b, c^Tx = f
+static bool check(const Sent &s, const LPResultHeader &r, const std::vector<double> &xy) {
+  const double *A = &s.data[0], *b = A + (size_t)s.m * s.n, *c = b + s.m;
+  const double tol = 1e-7;
+  double f = 0;
+  for (int j = 0; j < s.n; j++) {
+    if (xy[j] < -tol) return false;
+    f += c[j] * xy[j];
+  }
+  for (int i = 0; i < s.m; i++) {
+    double ax = 0;
+    for (int j = 0; j < s.n; j++) ax += A[i * s.n + j] * xy[j];
+    if (ax > b[i] + tol * (1 + std::fabs(b[i]))) return false;
+  }
+  return std::fabs(f - r.f) <= tol * (1 + std::fabs(f));
+}
+
+static void run(int id, const ClientOptions &opt, Totals &totals) {
+  int fd = connectTo(opt.socket);
+  if (fd < 0) {
+    std::lock_guard<std::mutex> lock(totals.mutex);
+    cout << "error: cannot connect to " << opt.socket << endl;
+    totals.failed += opt.jobs;
+    return;
+  }
+  std::mt19937 mt(opt.seed * 7919 + id);
+  std::map<uint64_t, Sent> inFlight;
+  std::vector<double> latencies;
+  long failed = 0, rejected = 0, stopped = 0, iterations = 0;
+  double queueTime = 0, solveTime = 0, chunk = 0;
+  int sent = 0, received = 0;
+  std::vector<char> payload;
+  while (received < opt.jobs) {
+    if (sent < opt.jobs && (int)inFlight.size() < opt.window) {
+      Sent s = generate(mt, opt, sent % 4 == 3);
+      uint64_t jobId = ((uint64_t)id << 32) | (uint64_t)sent;
+      s.time = Clock::now();
+      LPHeader h = makeHeader(LP_JOB, jobId, s.m, s.n, s.data.size() * sizeof(double));
+      if (!writeAll(fd, &h, sizeof(h)) || !writeAll(fd, &s.data[0], h.length)) break;
+      inFlight[jobId] = s;
+      sent++;
+      continue;
+    }
+    LPHeader h;
+    if (!readAll(fd, &h, sizeof(h)) || h.magic != LP_MAGIC || h.type != LP_RESULT) break;
+    payload.resize(h.length);
+    if (h.length > 0 && !readAll(fd, &payload[0], h.length)) break;
+    Clock::time_point now = Clock::now();
+    received++;
+    std::map<uint64_t, Sent>::iterator it = inFlight.find(h.id);
+    if (it == inFlight.end()) {
+      failed++;
+      continue;
+    }
+    LPResultHeader r;
+    std::memcpy(&r, &payload[0], sizeof(r));
+    std::vector<double> xy((h.length - sizeof(r)) / sizeof(double));
+    if (!xy.empty()) std::memcpy(&xy[0], &payload[sizeof(r)], xy.size() * sizeof(double));
+    if (r.status == LP_REJECTED) rejected++;
+    else if (r.status == SOLVE_TIME_LIMIT) stopped++;
+    else if (r.status != SOLVE_OPTIMAL || !check(it->second, r, xy)) failed++;
+    latencies.push_back(std::chrono::duration<double, std::micro>(now - it->second.time).count());
+    iterations += r.iterations;
+    queueTime += r.queueTime;
+    solveTime += r.solveTime;
+    chunk += r.chunk;
+    inFlight.erase(it);
+  }
+  ::close(fd);
+
+  std::lock_guard<std::mutex> lock(totals.mutex);
+  totals.jobs += received;
+  totals.failed += failed + (opt.jobs - received);
+  totals.rejected += rejected;
+  totals.stopped += stopped;
+  totals.iterations += iterations;
+  totals.queueTime += queueTime;
+  totals.solveTime += solveTime;
+  totals.chunk += chunk;
+  totals.latencies.insert(totals.latencies.end(), latencies.begin(), latencies.end());
+}
+
+int main(int argc, char **argv) {
+  ClientOptions opt;
+  for (int k = 1; k + 1 < argc; k += 2) {
+    std::string key = argv[k];
+    const char *value = argv[k+1];
+    if (key == "--socket") opt.socket = value;
+    else if (key == "--connections") opt.connections = std::max(1, std::atoi(value));
+    else if (key == "--jobs") opt.jobs = std::max(1, std::atoi(value));
+    else if (key == "--m") opt.m = std::max(1, std::atoi(value));
+    else if (key == "--n") opt.n = std::max(1, std::atoi(value));
+    else if (key == "--window") opt.window = std::max(1, std::atoi(value));
+    else if (key == "--seed") opt.seed = (unsigned)std::atoi(value);
+    else {
+      cout << "error: unknown option " << key << endl;
+      return 1;
+    }
+  }
+
+  Totals totals;
+  Clock::time_point start = Clock::now();
+  std::vector<std::thread> threads;
+  for (int k = 0; k < opt.connections; k++) {
+    threads.emplace_back(run, k, std::cref(opt), std::ref(totals));
+  }
+  for (size_t k = 0; k < threads.size(); k++) {
+    threads[k].join();
+  }
+  double wall = std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::vector<double> &l = totals.latencies;
+  std::sort(l.begin(), l.end());
+  double jobs = std::max(1L, totals.jobs);
+  cout << "connections: " << opt.connections << " window: " << opt.window << " m: " << opt.m
+       << " n: " << opt.n << endl;
+  cout << "jobs: " << totals.jobs << " failed: " << totals.failed << " rejected: " << totals.rejected
+       << " time limit: " << totals.stopped
+       << " time: " << wall << " [s] throughput: " << totals.jobs / wall << " [jobs/s]" << endl;
+  if (!l.empty()) {
+    cout << "latency p50: " << l[l.size() / 2] << " [μs] p99: " << l[std::min(l.size() - 1, l.size() * 99 / 100)]
+         << " [μs] max: " << l.back() << " [μs]" << endl;
+  }
+  cout << "server mean queue: " << totals.queueTime / jobs << " [μs] solve: " << totals.solveTime / jobs
+       << " [μs] chunk: " << totals.chunk / jobs << " iterations: " << totals.iterations / jobs << endl;
+
+  // サーバー全体の数字
+  int fd = connectTo(opt.socket);
+  LPHeader h = makeHeader(LP_METRICS, 0, 0, 0, 0);
+  if (fd >= 0 && writeAll(fd, &h, sizeof(h)) && readAll(fd, &h, sizeof(h))) {
+    std::string text(h.length, '\0');
+    if (h.length == 0 || readAll(fd, &text[0], h.length)) cout << "server metrics:\n" << text;
+  }
+  if (fd >= 0) ::close(fd);
+  return totals.failed == 0 ? 0 : 1;
+}
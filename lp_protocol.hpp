@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+// framing between lp_server and its clients over a Unix domain stream socket
+//
+// Every message is a fixed header followed by a payload of `length` bytes, in
+// the byte order of the machine (both ends run on the same host).
+//
+//   LP_JOB      client -> server  payload: A (m x n, row major), b (m), c (n) as double
+//   LP_RESULT   server -> client  payload: LPResultHeader, x (n), y (m) as double
+//   LP_METRICS  client -> server  payload ignored (normally empty)
+//               server -> client  payload: metrics as text, one "key value" per line
+//
+// Results come back in the order jobs finish, not the order they were sent;
+// `id` is chosen by the client and echoed. A job whose sizes exceed the
+// server's limits, or that the server has no memory for, is answered with
+// status LP_REJECTED and not solved.
+
+const uint32_t LP_MAGIC = 0x3150504c;  /* "LPP1" */
+
+enum LPMessageType : uint32_t {
+  LP_JOB = 1,
+  LP_RESULT = 2,
+  LP_METRICS = 3
+};
+
+const int32_t LP_REJECTED = -1;        /* status of a job the server refused */
+
+struct LPHeader {
+  uint32_t magic;
+  uint32_t type;                       /* LPMessageType */
+  uint64_t id;
+  int32_t m;                           /* rows of A (LP_JOB, LP_RESULT) */
+  int32_t n;                           /* columns of A (LP_JOB, LP_RESULT) */
+  uint64_t length;                     /* bytes of payload */
+};
+
+struct LPResultHeader {
+  int32_t status;                      /* SolveStatus or LP_REJECTED */
+  int32_t chunk;                       /* jobs taken from the queue with this one, solved one after another */
+  int64_t iterations;                  /* pivots */
+  double f;                            /* c^Tx */
+  double queueTime;                    /* [μs] from arrival to the start of the solve */
+  double solveTime;                    /* [μs] of the solve */
+};
+
+// n bytes を全て読む(書く). 相手が閉じたか失敗したらfalse
+inline bool readAll(int fd, void *buf, size_t n) {
+  char *p = static_cast<char *>(buf);
+  while (n > 0) {
+    ssize_t r = ::read(fd, p, n);
+    if (r < 0 && errno == EINTR) continue;
+    if (r <= 0) return false;
+    p += r;
+    n -= (size_t)r;
+  }
+  return true;
+}
+
+inline bool writeAll(int fd, const void *buf, size_t n) {
+  const char *p = static_cast<const char *>(buf);
+  while (n > 0) {
+    ssize_t r = ::write(fd, p, n);
+    if (r < 0 && errno == EINTR) continue;
+    if (r <= 0) return false;
+    p += r;
+    n -= (size_t)r;
+  }
+  return true;
+}
+
+inline LPHeader makeHeader(LPMessageType type, uint64_t id, int32_t m, int32_t n, uint64_t length) {
+  LPHeader h;
+  std::memset(&h, 0, sizeof(h));
+  h.magic = LP_MAGIC;
+  h.type = type;
+  h.id = id;
+  h.m = m;
+  h.n = n;
+  h.length = length;
+  return h;
+}
@@ -0,0 +1,477 @@
+// LP solve server
+//
+// Accepts LP_JOB messages (lp_protocol.hpp) on a Unix domain socket, queues
+// them in a bounded queue and solves them on a fixed pool of workers with
+// createMatrix (subProblem if b has a negative entry) and simplexMethod.
+//
+// - backpressure: when the queue is full the connection's reader blocks, so
+//   the socket buffer fills and the client's writes block
+// - chunking: a worker that takes a small job also takes the small jobs
+//   queued right behind it (up to --chunk) in the same pop and solves them one
+//   after another, so small jobs cost one queue lock and wake-up per chunk
+// - limits: a job whose (m+1) x (n+m+1) tableau has more than --max elements,
+//   or whose solve runs out of memory, is answered with LP_REJECTED
+// - metrics: every result carries its queue and solve time; LP_METRICS
+//   returns counters, queue depth and latency percentiles of recent jobs
+//
+// usage: lp_server [--socket path] [--workers k] [--queue k] [--chunk k]
+//                  [--small elements] [--max elements] [--time-limit s]
+
+#include "simplex.hpp"
+#include "budget.hpp"
+#include "lp_protocol.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using std::cout;
+using std::endl;
+typedef std::chrono::steady_clock Clock;
+
+struct ServerOptions {
+  std::string socket = "/tmp/lp_server.sock";
+  int workers = 0;              /* 0: std::thread::hardware_concurrency() */
+  size_t queue = 256;           /* jobs waiting to be solved */
+  size_t chunk = 16;            /* small jobs taken by a worker at once */
+  long small = 10000;           /* a job with m * n up to this is small */
+  long max = 1L << 26;          /* jobs with a larger (m+1) x (n+m+1) tableau are rejected */
+  double timeLimit = 0;         /* [s] per solve, 0 is no limit */
+};
+
+// 一つの接続. 結果は複数のワーカーが書くので書き込みは排他にする.
+// 最後の仕事が終わって参照がなくなった時に閉じる
+class Connection {
+ public:
+  explicit Connection(int fd) : fd(fd) {}
+  ~Connection() { ::close(fd); }
+
+  bool send(const LPHeader &header, const void *payload) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return writeAll(fd, &header, sizeof(header)) && writeAll(fd, payload, header.length);
+  }
+
+  const int fd;
+
+ private:
+  std::mutex mutex;
+};
+
+struct Job {
+  std::shared_ptr<Connection> connection;
+  uint64_t id;
+  Matrix A;
+  Vector b;
+  Vector c;
+  Clock::time_point arrival;
+};
+
+// 上限のある仕事の列. 満杯ならpushが空くまで待つ
+class JobQueue {
+ public:
+  explicit JobQueue(size_t capacity) : capacity(capacity), closed(false), maxDepth(0) {}
+
+  bool push(std::unique_ptr<Job> job) {
+    std::unique_lock<std::mutex> lock(mutex);
+    notFull.wait(lock, [&] { return closed || jobs.size() < capacity; });
+    if (closed) return false;
+    jobs.push_back(std::move(job));
+    maxDepth = std::max(maxDepth, jobs.size());
+    notEmpty.notify_one();
+    return true;
+  }
+
+  // 先頭の仕事を取り, それが小さければ後ろに続く小さな仕事もmaxChunk個まで取る.
+  // 閉じられて空ならfalse
+  bool pop(std::vector<std::unique_ptr<Job> > &chunk, size_t maxChunk, long small) {
+    chunk.clear();
+    std::unique_lock<std::mutex> lock(mutex);
+    notEmpty.wait(lock, [&] { return closed || !jobs.empty(); });
+    if (jobs.empty()) return false;
+    do {
+      chunk.push_back(std::move(jobs.front()));
+      jobs.pop_front();
+    } while (chunk.size() < maxChunk && !jobs.empty() && elements(*chunk[0]) <= small &&
+             elements(*jobs.front()) <= small);
+    notFull.notify_all();
+    return true;
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+    notFull.notify_all();
+    notEmpty.notify_all();
+  }
+
+  size_t depth() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return jobs.size();
+  }
+
+  size_t peakDepth() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return maxDepth;
+  }
+
+ private:
+  static long elements(const Job &job) { return (long)job.b.getSize() * job.c.getSize(); }
+
+  const size_t capacity;
+  bool closed;
+  size_t maxDepth;
+  std::mutex mutex;
+  std::condition_variable notFull;
+  std::condition_variable notEmpty;
+  std::deque<std::unique_ptr<Job> > jobs;
+};
+
+// 件数と, 直近の仕事の待ち時間と応答時間(到着から結果を送るまで)
+class Metrics {
+ public:
+  Metrics() : jobs(0), rejected(0), chunks(0), next(0) {}
+
+  void job(double queueTime, double latency) {
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs++;
+    if (latencies.size() < RECENT) {
+      queueTimes.push_back(queueTime);
+      latencies.push_back(latency);
+    } else {
+      queueTimes[next] = queueTime;
+      latencies[next] = latency;
+      next = (next + 1) % RECENT;
+    }
+  }
+
+  void reject() {
+    std::lock_guard<std::mutex> lock(mutex);
+    rejected++;
+  }
+
+  void chunk() {
+    std::lock_guard<std::mutex> lock(mutex);
+    chunks++;
+  }
+
+  std::string report(JobQueue &queue) {
+    std::vector<double> q, l;
+    std::ostringstream out;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      q = queueTimes;
+      l = latencies;
+      out << "jobs " << jobs << "\n" << "rejected " << rejected << "\n" << "chunks " << chunks << "\n";
+    }
+    out << "queue_depth " << queue.depth() << "\n" << "max_queue_depth " << queue.peakDepth() << "\n";
+    std::sort(q.begin(), q.end());
+    std::sort(l.begin(), l.end());
+    out << "queue_p50_us " << percentile(q, 0.5) << "\n" << "queue_p99_us " << percentile(q, 0.99) << "\n";
+    out << "latency_p50_us " << percentile(l, 0.5) << "\n" << "latency_p99_us " << percentile(l, 0.99) << "\n";
+    out << "latency_max_us " << (l.empty() ? 0 : l.back()) << "\n";
+    return out.str();
+  }
+
+ private:
+  static double percentile(const std::vector<double> &v, double p) {
+    if (v.empty()) return 0;
+    return v[std::min(v.size() - 1, (size_t)(p * v.size()))];
+  }
+
+  static const size_t RECENT = 1 << 16;
+  std::mutex mutex;
+  long jobs;
+  long rejected;
+  long chunks;
+  size_t next;
+  std::vector<double> queueTimes;
+  std::vector<double> latencies;
+};
+
+// 読み込み中の接続. 止める時は読む側を閉じ, 全てのreaderが抜けるのを待つ
+class Readers {
+ public:
+  Readers() : active(0) {}
+
+  void add(const std::shared_ptr<Connection> &connection) {
+    std::lock_guard<std::mutex> lock(mutex);
+    connections.erase(std::remove_if(connections.begin(), connections.end(),
+                                     [](const std::weak_ptr<Connection> &c) { return c.expired(); }),
+                      connections.end());
+    connections.push_back(connection);
+    active++;
+  }
+
+  void done() {
+    std::lock_guard<std::mutex> lock(mutex);
+    active--;
+    finished.notify_all();
+  }
+
+  void stop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (size_t k = 0; k < connections.size(); k++) {
+      std::shared_ptr<Connection> connection = connections[k].lock();
+      if (connection) ::shutdown(connection->fd, SHUT_RD);
+    }
+    finished.wait(lock, [&] { return active == 0; });
+  }
+
+ private:
+  int active;
+  std::mutex mutex;
+  std::condition_variable finished;
+  std::vector<std::weak_ptr<Connection> > connections;
+};
+
+static double microseconds(Clock::time_point from, Clock::time_point to) {
+  return std::chrono::duration_cast<std::chrono::duration<double, std::micro> >(to - from).count();
+}
+
+static void reply(Connection &connection, uint64_t id, int m, int n, const LPResultHeader &result,
+                  const std::vector<double> &xy) {
+  std::vector<char> payload(sizeof(result) + xy.size() * sizeof(double));
+  std::memcpy(&payload[0], &result, sizeof(result));
+  if (!xy.empty()) std::memcpy(&payload[sizeof(result)], &xy[0], xy.size() * sizeof(double));
+  connection.send(makeHeader(LP_RESULT, id, m, n, payload.size()), &payload[0]);
+}
+
+// 一つの仕事を解き, xとyを続けてxyに入れる
+static SolveStatus solve(const Job &job, const ServerOptions &opt, std::vector<double> &xy,
+                         LPResultHeader &result) {
+  int m = job.b.getSize();
+  int n = job.c.getSize();
+  Clock::time_point start = Clock::now();
+  SimplexOptions<double> so;
+  so.timeLimit = opt.timeLimit;
+  SimplexResult<double> r;
+  Basis basis;
+  Matrix All;
+  bool nonnegative_b = true;
+  for (int i = 0; i < m; i++) {
+    if (job.b[i] < 0) nonnegative_b = false;
+  }
+  SolveStatus status;
+  if (nonnegative_b) {
+    createMatrix(job.A, job.b, job.c, basis).swap(All);
+    status = simplexMethod(All, basis, so, &r);
+  } else {
+    // 第二段階には第一段階の残りの時間だけ
+    status = subProblem(job.A, job.b, job.c, All, basis, so, &r);
+    SimplexOptions<double> rest;
+    if (status == SOLVE_OPTIMAL) status = remainingBudget(so, r.stats.iterations, start, rest);
+    if (status == SOLVE_OPTIMAL) status = simplexMethod(All, basis, rest, &r);
+  }
+  result.iterations = r.stats.iterations;
+  xy.assign(n + m, 0);
+  if (status == SOLVE_OPTIMAL) {
+    Solution<double> sol = getSolution(All, basis);
+    for (int j = 0; j < n; j++) xy[j] = sol.x[j];
+    for (int i = 0; i < m; i++) xy[n+i] = sol.dual[i];
+    result.f = sol.f;
+  } else if (status == SOLVE_UNBOUNDED) {
+    for (int j = 0; j < n; j++) xy[j] = r.ray[j];
+  } else if (status == SOLVE_INFEASIBLE) {
+    for (int i = 0; i < m; i++) xy[n+i] = r.farkas[i];
+  }
+  return status;
+}
+
+// 断った仕事への返事(x, yなし)
+static void reject(Connection &connection, uint64_t id, Metrics &metrics) {
+  metrics.reject();
+  LPResultHeader result;
+  std::memset(&result, 0, sizeof(result));
+  result.status = LP_REJECTED;
+  reply(connection, id, 0, 0, result, std::vector<double>());
+}
+
+// 取った仕事を順に解く. 数字は結果を送る前に更新するので, 結果を受け取った
+// クライアントがLP_METRICSを送れば, その仕事はもう数えられている
+static void worker(JobQueue &queue, Metrics &metrics, const ServerOptions &opt) {
+  std::vector<std::unique_ptr<Job> > chunk;
+  std::vector<double> xy;
+  while (queue.pop(chunk, opt.chunk, opt.small)) {
+    metrics.chunk();
+    for (size_t k = 0; k < chunk.size(); k++) {
+      Job &job = *chunk[k];
+      LPResultHeader result;
+      std::memset(&result, 0, sizeof(result));
+      Clock::time_point start = Clock::now();
+      try {
+        result.status = solve(job, opt, xy, result);
+      } catch (const std::bad_alloc &) {
+        std::vector<double>().swap(xy);
+        reject(*job.connection, job.id, metrics);
+        continue;
+      }
+      Clock::time_point end = Clock::now();
+      result.chunk = (int32_t)chunk.size();
+      result.queueTime = microseconds(job.arrival, start);
+      result.solveTime = microseconds(start, end);
+      metrics.job(result.queueTime, microseconds(job.arrival, Clock::now()));
+      reply(*job.connection, job.id, job.b.getSize(), job.c.getSize(), result, xy);
+    }
+  }
+}
+
+// length バイトを読み捨てる
+static bool skip(int fd, uint64_t length) {
+  char chunk[1 << 16];
+  while (length > 0) {
+    size_t k = (size_t)std::min<uint64_t>(length, sizeof(chunk));
+    if (!readAll(fd, chunk, k)) return false;
+    length -= k;
+  }
+  return true;
+}
+
+// 接続から読んで列に積む. 列が満杯の間はここで止まる
+static void readJobs(std::shared_ptr<Connection> connection, JobQueue &queue, Metrics &metrics,
+                     const ServerOptions &opt) {
+  LPHeader h;
+  std::vector<double> buf;
+  while (readAll(connection->fd, &h, sizeof(h))) {
+    if (h.magic != LP_MAGIC) break;
+    if (h.type == LP_METRICS) {
+      if (!skip(connection->fd, h.length)) break;
+      std::string text = metrics.report(queue);
+      connection->send(makeHeader(LP_METRICS, h.id, 0, 0, text.size()), text.data());
+      continue;
+    }
+    if (h.type != LP_JOB || h.m < 0 || h.n < 0) break;
+    // m, n < 2^31 なので以下の積は long に収まる
+    long m = h.m, n = h.n;
+    if (h.length % sizeof(double) != 0 || h.length / sizeof(double) != (uint64_t)(m * n + m + n)) break;
+    // 解く時の表は (m+1) x (n+m+1). 大きすぎれば読み捨ててから断る
+    bool fits = m <= opt.max && n <= opt.max && (m + 1) * (n + m + 1) <= opt.max;
+    bool consumed = false;
+    std::unique_ptr<Job> job;
+    if (fits) {
+      try {
+        buf.resize(m * n + m + n);
+        if (!buf.empty() && !readAll(connection->fd, &buf[0], h.length)) break;
+        consumed = true;
+        job.reset(new Job);
+        job->connection = connection;
+        job->id = h.id;
+        job->A.setSize(m, n);
+        job->b.setSize(m);
+        job->c.setSize(n);
+        for (int i = 0; i < m; i++) {
+          for (int j = 0; j < n; j++) {
+            job->A[i][j] = buf[i * n + j];
+          }
+          job->b[i] = buf[m * n + i];
+        }
+        for (int j = 0; j < n; j++) {
+          job->c[j] = buf[m * n + m + j];
+        }
+      } catch (const std::bad_alloc &) {
+        job.reset();
+        std::vector<double>().swap(buf);
+      }
+    }
+    if (!job) {
+      if (!consumed && !skip(connection->fd, h.length)) break;
+      reject(*connection, h.id, metrics);
+      continue;
+    }
+    job->arrival = Clock::now();
+    if (!queue.push(std::move(job))) break;
+  }
+}
+
+static void reader(std::shared_ptr<Connection> connection, JobQueue &queue, Metrics &metrics,
+                   const ServerOptions &opt, Readers &readers) {
+  readJobs(connection, queue, metrics, opt);
+  connection.reset();
+  readers.done();
+}
+
+static volatile std::sig_atomic_t stopRequested = 0;
+
+static void onSignal(int) { stopRequested = 1; }
+
+int main(int argc, char **argv) {
+  ServerOptions opt;
+  for (int k = 1; k + 1 < argc; k += 2) {
+    std::string key = argv[k];
+    const char *value = argv[k+1];
+    if (key == "--socket") opt.socket = value;
+    else if (key == "--workers") opt.workers = std::atoi(value);
+    else if (key == "--queue") opt.queue = std::max(1, std::atoi(value));
+    else if (key == "--chunk") opt.chunk = std::max(1, std::atoi(value));
+    else if (key == "--small") opt.small = std::atol(value);
+    else if (key == "--max") opt.max = std::atol(value);
+    else if (key == "--time-limit") opt.timeLimit = std::atof(value);
+    else {
+      cout << "error: unknown option " << key << endl;
+      return 1;
+    }
+  }
+  int workers = opt.workers > 0 ? opt.workers : (int)std::thread::hardware_concurrency();
+  if (workers < 1) workers = 1;
+
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (fd < 0 || opt.socket.size() >= sizeof(addr.sun_path)) {
+    cout << "error: cannot create socket " << opt.socket << endl;
+    return 1;
+  }
+  std::strcpy(addr.sun_path, opt.socket.c_str());
+  ::unlink(opt.socket.c_str());
+  if (::bind(fd, (sockaddr *)&addr, sizeof(addr)) < 0 || ::listen(fd, 64) < 0) {
+    cout << "error: cannot listen on " << opt.socket << ": " << std::strerror(errno) << endl;
+    return 1;
+  }
+  std::signal(SIGPIPE, SIG_IGN);
+  std::signal(SIGINT, onSignal);
+  std::signal(SIGTERM, onSignal);
+
+  JobQueue queue(opt.queue);
+  Metrics metrics;
+  Readers readers;
+  std::vector<std::thread> pool;
+  for (int k = 0; k < workers; k++) {
+    pool.emplace_back(worker, std::ref(queue), std::ref(metrics), std::cref(opt));
+  }
+  cout << "listening on " << opt.socket << " workers: " << workers << " queue: " << opt.queue
+       << " chunk: " << opt.chunk << endl;
+
+  while (!stopRequested) {
+    pollfd p = {fd, POLLIN, 0};
+    if (::poll(&p, 1, 200) <= 0) continue;
+    int client = ::accept(fd, 0, 0);
+    if (client < 0) continue;
+    std::shared_ptr<Connection> connection = std::make_shared<Connection>(client);
+    readers.add(connection);
+    std::thread(reader, connection, std::ref(queue), std::ref(metrics), std::cref(opt),
+                std::ref(readers)).detach();
+  }
+
+  // 新しい仕事の受け付けを止め, 積まれた仕事は解き終えてから止まる
+  ::close(fd);
+  ::unlink(opt.socket.c_str());
+  queue.close();
+  readers.stop();
+  for (size_t k = 0; k < pool.size(); k++) {
+    pool[k].join();
+  }
+  cout << metrics.report(queue);
+  return 0;
+}
@@ -0,0 +1,359 @@
+#include "mapped_tableau.hpp"
+#include "budget.hpp"
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+using std::cout;
+using std::endl;
+
+template <class T>
+MappedTableau<T>::MappedTableau(int m, int n, const MappedOptions &opt)
+    : m(m), n(n), release(opt.release), fd(-1), data(0), length((size_t)m * (n + m) * sizeof(T)),
+      obj(n + m + 1), beta(m) {
+  long column = std::max(1L, (long)(m * sizeof(T)));
+  panelColumns = (int)std::max(1L, std::min((long)std::max(1, n + m), opt.panelBytes / column));
+  panels = (n + m + panelColumns - 1) / panelColumns;
+  if (length == 0) return;
+
+  if (opt.path.empty()) {
+    const char *dir = std::getenv("TMPDIR");
+    std::string name = std::string(dir && *dir ? dir : "/tmp") + "/tableau-XXXXXX";
+    std::vector<char> buf(name.begin(), name.end());
+    buf.push_back('\0');
+    fd = ::mkstemp(&buf[0]);
+    if (fd >= 0) ::unlink(&buf[0]);
+  } else {
+    fd = ::open(opt.path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  }
+  if (fd < 0 || ::ftruncate(fd, (off_t)length) != 0) {
+    cout << "error: cannot create the tableau file: " << std::strerror(errno) << endl;
+    std::abort();
+  }
+  void *p = ::mmap(0, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED) {
+    cout << "error: cannot map the tableau file: " << std::strerror(errno) << endl;
+    std::abort();
+  }
+  data = static_cast<T *>(p);
+  ::madvise(p, length, MADV_SEQUENTIAL);
+}
+
+template <class T>
+MappedTableau<T>::~MappedTableau() {
+  if (data) ::munmap(data, length);
+  if (fd >= 0) ::close(fd);
+}
+
+// パネルpのページに助言する. MADV_WILLNEEDは両端を外側のページ境界まで広げ,
+// MADV_DONTNEEDは内側に縮める(隣と共有する境目のページ, パネルごとに高々一つは残る)
+template <class T>
+void MappedTableau<T>::advise(int p, int advice) const {
+  if (!data || p < 0 || p >= panels) return;
+  const size_t page = (size_t)::sysconf(_SC_PAGESIZE);
+  size_t begin = (size_t)panelBegin(p) * m * sizeof(T);
+  size_t end = (size_t)panelBegin(p+1) * m * sizeof(T);
+  if (advice == MADV_DONTNEED) {
+    // 境目のページはprefetchしたばかりの次のパネルと共有している.
+    // 最後のパネルは表の終わりまで
+    begin += (page - begin % page) % page;
+    if (p+1 < panels) end -= end % page;
+    if (end <= begin) return;
+  } else {
+    begin -= begin % page;
+  }
+  ::madvise((char *)data + begin, end - begin, advice);
+}
+
+template <class T>
+void MappedTableau<T>::prefetch(int p) const {
+  advise(p, MADV_WILLNEED);
+}
+
+template <class T>
+void MappedTableau<T>::done(int p) const {
+  if (release) advise(p, MADV_DONTNEED);
+}
+
+template <class T>
+void createMatrix(const std::function<void(int, T *)> &column, const BasicVector<T> &b,
+                  const BasicVector<T> &c, MappedTableau<T> &All, Basis &basis) {
+  int m = All.getRow();
+  int n = All.getCol();
+  if (b.getSize() != m || c.getSize() != n) {
+    cout << "error: sizes do not match" << "\n";
+    std::abort();
+  }
+  for (int i = 0; i < m; i++) {
+    if (b[i] < 0) {
+      cout << "error: negative b (a mapped tableau has no phase 1)" << "\n";
+      std::abort();
+    }
+  }
+  for (int p = 0; p < All.getPanels(); p++) {
+    for (int j = All.panelBegin(p); j < All.panelBegin(p+1); j++) {
+      T *a = All.column(j);
+      if (j < n) {
+        column(j, a);
+      } else {
+        std::fill(a, a + m, T(0));
+        a[j-n] = 1;
+      }
+    }
+    All.done(p);
+  }
+  BasicVector<T> &d = All.objective();
+  for (int j = 0; j < n+m+1; j++) {
+    d[j] = j < n ? -c[j] : T(0);
+  }
+  for (int i = 0; i < m; i++) {
+    All.rhs()[i] = b[i];
+  }
+  basis.resize(m);
+  for (int i = 0; i < m; i++) {
+    basis[i] = n+i;
+  }
+}
+
+template <class T>
+void createMatrix(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                  MappedTableau<T> &All, Basis &basis) {
+  if (A.getRow() != b.getSize() || A.getCol() != c.getSize()) {
+    cout << "error: sizes do not match" << "\n";
+    std::abort();
+  }
+  int m = A.getRow();
+  createMatrix(std::function<void(int, T *)>([&A, m](int j, T *a) {
+                 for (int i = 0; i < m; i++) a[i] = A[i][j];
+               }),
+               b, c, All, basis);
+}
+
+// 列aを1 + ||a||^2 (最急辺規則の重み)
+template <class T>
+static T columnWeight(const T *a, int m) {
+  T w = 1;
+  for (int i = 0; i < m; i++) w += a[i] * a[i];
+  return w;
+}
+
+// 行ROW, 列COLでピボットする. pcは掃き出す前のCOL列(目的関数の係数はdc).
+// パネルを順に一度ずつ読み書きし, 書き換えた列の小さな要素を0にして
+// weightが空でなければ重みも計算し直す
+template <class T>
+static void pivot(MappedTableau<T> &All, int ROW, int COL, const BasicVector<T> &pc, T dc,
+                  BasicVector<T> &weight) {
+  const int W = ScalarTraits<T>::simdWidth;
+  const T zero = ScalarTraits<T>::zeroTolerance();
+  int m = All.getRow();
+  int cols = All.getCol() + m;
+  BasicVector<T> &d = All.objective();
+  BasicVector<T> &beta = All.rhs();
+  const T p = pc[ROW];
+  const T *q = &pc[0];
+  All.prefetch(0);
+  for (int k = 0; k < All.getPanels(); k++) {
+    All.prefetch(k+1);
+    for (int j = All.panelBegin(k); j < All.panelBegin(k+1); j++) {
+      T *a = All.column(j);
+      if (j == COL) {
+        std::fill(a, a + m, T(0));
+        a[ROW] = 1;
+        d[j] = 0;
+        if (weight.getSize()) weight[j] = 2;
+        continue;
+      }
+      if (a[ROW] == 0) continue;
+      T t = a[ROW] / p;
+      T big = 0;
+      int i = 0;
+      for (; i + W <= m; i += W) {
+        for (int l = 0; l < W; l++) {
+          a[i+l] -= t * q[i+l];
+        }
+      }
+      for (; i < m; i++) {
+        a[i] -= t * q[i];
+      }
+      a[ROW] = t;
+      for (i = 0; i < m; i++) big = std::max(big, std::fabs(a[i]));
+      for (i = 0; i < m; i++) {
+        if (std::fabs(a[i]) < zero * big) a[i] = 0;
+      }
+      d[j] -= t * dc;
+      if (weight.getSize()) weight[j] = columnWeight(a, m);
+    }
+    All.done(k);
+  }
+  T t = beta[ROW] / p;
+  for (int i = 0; i < m; i++) {
+    beta[i] -= t * pc[i];
+  }
+  beta[ROW] = t;
+  T big = 0;
+  for (int i = 0; i < m; i++) big = std::max(big, std::fabs(beta[i]));
+  for (int i = 0; i < m; i++) {
+    if (std::fabs(beta[i]) < zero * big) beta[i] = 0;
+  }
+  d[cols] -= t * dc;
+}
+
+template <class T>
+SolveStatus simplexMethod(MappedTableau<T> &All, Basis &basis, const SimplexOptions<T> &opt,
+                          SimplexResult<T> *result) {
+  SimplexResult<T> local;
+  SimplexResult<T> &r = result ? *result : local;
+  SimplexStats &stats = r.stats;
+  int m = All.getRow();
+  int n = All.getCol();
+  int cols = n+m;
+  const T tol = ScalarTraits<T>::nearlyZero();
+  const T optimality = opt.optimality > 0 ? opt.optimality : tol;
+  BasicVector<T> &d = All.objective();
+  BasicVector<T> &beta = All.rhs();
+  BasicVector<T> pc(m);
+  BasicVector<T> weight;
+  if (opt.pricing == PRICING_STEEPEST_EDGE) {
+    // 重みは最初に一度だけ全ての列から計算し, 後はピボットのついでに更新する
+    weight.setSize(cols);
+    All.prefetch(0);
+    for (int k = 0; k < All.getPanels(); k++) {
+      All.prefetch(k+1);
+      for (int j = All.panelBegin(k); j < All.panelBegin(k+1); j++) {
+        weight[j] = columnWeight(All.column(j), m);
+      }
+      All.done(k);
+    }
+  }
+  long stall = r.stall;
+  bool bland = opt.pricing == PRICING_BLAND || stall >= opt.stallLimit;
+  r.stall = 0;
+  Budget<T> budget(opt, stats);
+
+  while (true) {
+    // 入る列(目的関数の行はメモリにあるのでファイルには触れない)
+    T S = 0;
+    int SI = -1;
+    if (!bland && opt.pricing == PRICING_STEEPEST_EDGE) {
+      T best = 0;
+      for (int j = 0; j < cols; j++) {
+        if (d[j] < -optimality && chmax(best, d[j] * d[j] / weight[j])) {
+          S = d[j];
+          SI = j;
+        }
+      }
+    } else if (!bland) {
+      for (int j = 0; j < cols; j++) {
+        SI = (chmin(S, d[j]) ? j : SI);
+      }
+    } else {
+      for (int j = 0; j < cols; j++) {
+        if (d[j] < -optimality) {
+          S = d[j];
+          SI = j;
+          break;
+        }
+      }
+    }
+    if (S >= -optimality) {
+      r.status = SOLVE_OPTIMAL;
+      return r.status;
+    }
+
+    // 比の検定は入る列だけをファイルから読む
+    const T *a = All.column(SI);
+    for (int i = 0; i < m; i++) {
+      pc[i] = a[i];
+    }
+    T P = std::numeric_limits<T>::max();
+    int PI = -1;
+    for (int i = 0; i < m; i++) {
+      if (pc[i] > tol) {
+        T ratio = beta[i] / pc[i];
+        if (chmin(P, ratio)) {
+          PI = i;
+        } else if (bland && ratio == P && basis[i] < basis[PI]) {
+          PI = i;
+        }
+      }
+    }
+    if (PI == -1) {
+      r.ray.setSize(n);
+      if (SI < n) r.ray[SI] = 1;
+      for (int i = 0; i < m; i++) {
+        if (basis[i] >= 0 && basis[i] < n) r.ray[basis[i]] = -pc[i];
+      }
+      r.status = SOLVE_UNBOUNDED;
+      return r.status;
+    }
+
+    // 予算. 実行不可能な基底はないので実行不可能性は0
+    SolveStatus stop = budget.check([&](T &objective, T &infeasibility) {
+      objective = d[cols];
+      infeasibility = 0;
+    });
+    if (stop != SOLVE_OPTIMAL) {
+      r.stall = stall;
+      r.status = stop;
+      return r.status;
+    }
+
+    pivot(All, PI, SI, pc, S, weight);
+    basis[PI] = SI;
+    stats.iterations++;
+
+    if (P > tol) {
+      stall = 0;
+      bland = opt.pricing == PRICING_BLAND;
+      continue;
+    }
+    stats.degeneratePivots++;
+    if (bland) stats.blandPivots++;
+    stall++;
+    if (stall > stats.longestStall) stats.longestStall = stall;
+    if (stall >= opt.stallLimit) bland = true;
+  }
+}
+
+template <class T>
+Solution<T> getSolution(const MappedTableau<T> &All, const Basis &basis) {
+  int m = All.getRow();
+  int n = All.getCol();
+  const BasicVector<T> &d = All.objective();
+  Solution<T> sol = {BasicVector<T>(n), BasicVector<T>(m), BasicVector<T>(m),
+                     BasicVector<T>(n), d[n+m]};
+  for (int i = 0; i < m; i++) {
+    int j = basis[i];
+    if (j < 0) continue;
+    if (j < n) sol.x[j] = All.rhs()[i];
+    else sol.slack[j-n] = All.rhs()[i];
+  }
+  for (int i = 0; i < m; i++) {
+    sol.dual[i] = d[n+i];
+  }
+  for (int j = 0; j < n; j++) {
+    sol.reducedCost[j] = d[j];
+  }
+  return sol;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                          explicit instantiation                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#define INSTANTIATE_MAPPED_TABLEAU(T)                                          \
+  template class MappedTableau<T>;                                             \
+  template void createMatrix(const BasicMatrix<T> &, const BasicVector<T> &, const BasicVector<T> &, \
+                             MappedTableau<T> &, Basis &);                     \
+  template void createMatrix(const std::function<void(int, T *)> &, const BasicVector<T> &, \
+                             const BasicVector<T> &, MappedTableau<T> &, Basis &); \
+  template SolveStatus simplexMethod(MappedTableau<T> &, Basis &, const SimplexOptions<T> &, \
+                                     SimplexResult<T> *);                      \
+  template Solution<T> getSolution(const MappedTableau<T> &, const Basis &);
+
+INSTANTIATE_MAPPED_TABLEAU(float)
+INSTANTIATE_MAPPED_TABLEAU(double)
+INSTANTIATE_MAPPED_TABLEAU(long double)
@@ -0,0 +1,93 @@
+#pragma once
+#include "simplex.hpp"
+#include <algorithm>
+#include <string>
+
+// out-of-core tableau for maximize c^Tx s.t. Ax \leq b, x \geq 0
+//
+// The m constraint rows of the tableau [A I b; -c 0 0] live in a file mapped
+// with mmap, column major: column j (of the n+m columns of A and I) is m
+// contiguous entries at offset j * m. The columns are grouped into panels of
+// about MappedOptions::panelBytes; every pivot walks the panels in order,
+// asking the kernel to read the next panel ahead (MADV_WILLNEED) and, if
+// release is set, handing back the pages of the panel it has finished
+// (MADV_DONTNEED; the pages are shared with the file, so nothing is lost).
+// The whole mapping is MADV_SEQUENTIAL. What pricing and the ratio test look
+// at stays in memory: the objective row (n+m+1, the last entry is c^Tx), the
+// right-hand side (m), the basis header and, for PRICING_STEEPEST_EDGE, the
+// column weights. Choosing the entering column therefore touches no panel,
+// the ratio test reads only the entering column, and the pivot is one
+// sequential read-modify-write pass over the file. Resident memory is
+// O(n+m) plus about two panels, so the tableau may be larger than RAM.
+//
+// There is no phase 1 and no perturbation: b must be nonnegative (as for
+// createMatrix; subProblem has no mapped counterpart), and after stallLimit
+// zero-step pivots in a row Bland's rule is used until the next nondegenerate
+// pivot. Tiny entries are zeroed column by column (below zeroTolerance times
+// the largest entry of the column) as the pivot updates them.
+
+struct MappedOptions {
+  std::string path;             /* file of the tableau; empty is an unlinked temporary file in $TMPDIR or /tmp */
+  long panelBytes = 64L << 20;  /* bytes of one panel (whole columns, at least one) */
+  bool release = true;          /* drop the pages of a panel from the process once a pass is done with it */
+};
+
+template <class T>
+class MappedTableau {
+ public:
+  // the file is created (or truncated) to m(n+m) entries; it is scratch
+  // storage and is left in place only if opt.path names it
+  MappedTableau(int m, int n, const MappedOptions &opt = MappedOptions());
+  ~MappedTableau();
+  MappedTableau(const MappedTableau &) = delete;
+  MappedTableau &operator=(const MappedTableau &) = delete;
+
+  int getRow() const { return m; }              /* constraints */
+  int getCol() const { return n; }              /* structural variables */
+  // column j of the constraint rows, m entries
+  T *column(int j) { return data + (size_t)j * m; }
+  const T *column(int j) const { return data + (size_t)j * m; }
+  BasicVector<T> &objective() { return obj; }   /* [y^TA - c, y | c^Tx], n+m+1 */
+  const BasicVector<T> &objective() const { return obj; }
+  BasicVector<T> &rhs() { return beta; }        /* basic values, m */
+  const BasicVector<T> &rhs() const { return beta; }
+
+  int getPanels() const { return panels; }
+  int panelBegin(int p) const { return std::min(p * panelColumns, n + m); }
+  void prefetch(int p) const;                   /* MADV_WILLNEED on panel p (if it exists) */
+  void done(int p) const;                       /* MADV_DONTNEED on the whole pages of panel p if MappedOptions::release */
+  long bytes() const { return (long)length; }   /* size of the file */
+
+ private:
+  void advise(int p, int advice) const;
+  int m, n;
+  int panelColumns, panels;
+  bool release;
+  int fd;
+  T *data;
+  size_t length;
+  BasicVector<T> obj;
+  BasicVector<T> beta;
+};
+
+// 入力行列を写像した表に書き込む(基底はスラック変数). Allは b, c の大きさで
+// 作っておく. bは0以上
+template <class T>
+void createMatrix(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                  MappedTableau<T> &All, Basis &basis);
+
+// Aがメモリに載らない場合: column(j, a) がAのj列目(m個)をaに書く. パネルの順に呼ぶ
+template <class T>
+void createMatrix(const std::function<void(int, T *)> &column, const BasicVector<T> &b,
+                  const BasicVector<T> &c, MappedTableau<T> &All, Basis &basis);
+
+// 写像した表での単体法. optの価格付け, 退化の扱い(摂動はしない), 予算が効く
+// (diagnosticはメモリ上の表を受け取るので呼ばない). 予算で止まった表は同じ
+// resultと一緒にもう一度渡せば続きから解ける
+template <class T>
+SolveStatus simplexMethod(MappedTableau<T> &All, Basis &basis,
+                          const SimplexOptions<T> &opt = SimplexOptions<T>(), SimplexResult<T> *result = 0);
+
+// 解を読み出す(ファイルには触れない). O(m+n)
+template <class T>
+Solution<T> getSolution(const MappedTableau<T> &All, const Basis &basis);
@@ -1,4 +1,24 @@
 #include "matrix.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// gemm blocking: MC x KC block of A and KC x NC panel of B are packed so that
+// they stay in L2 / L3, the MR x NR block of C stays in registers
+#define GEMM_MC 96
+#define GEMM_KC 256
+#define GEMM_NC 4096
+#define GEMM_MR 4
+// NR is two SIMD registers of T wide (at least 4)
+#define GEMM_NR(T) (2 * ScalarTraits<T>::simdWidth > 4 ? 2 * ScalarTraits<T>::simdWidth : 4)
+// products with fewer flops than this run on the calling thread
+#define GEMM_PARALLEL_FLOPS 4.E6
 
 ///////////////////////////////////////////////////////////////////////////////
 //                                   Vector                                  //
@@ -6,34 +26,40 @@
 
 // not member /////////////////////////////////////////////////////////////////
 
-const Vector operator+(const Vector &left, const Vector &right) {
-  Vector v = left;
+template <class T>
+const BasicVector<T> operator+(const BasicVector<T> &left, const BasicVector<T> &right) {
+  BasicVector<T> v = left;
   return v += right;
 }
 
-const Vector operator-(const Vector &left, const Vector &right) {
-  Vector v = left;
+template <class T>
+const BasicVector<T> operator-(const BasicVector<T> &left, const BasicVector<T> &right) {
+  BasicVector<T> v = left;
   return v -= right;
 }
 
-const Vector operator*(const Vector &left, double c) {
-  Vector v = left;
+template <class T>
+const BasicVector<T> operator*(const BasicVector<T> &left, typename BasicVector<T>::Scalar c) {
+  BasicVector<T> v = left;
   return v *= c;
 }
 
-const Vector operator*(double c, const Vector &right) {
-  Vector v = right;
+template <class T>
+const BasicVector<T> operator*(typename BasicVector<T>::Scalar c, const BasicVector<T> &right) {
+  BasicVector<T> v = right;
   return v *= c;
 }
 
-const Vector operator/(const Vector &left, double c) {
-  Vector v = left;
+template <class T>
+const BasicVector<T> operator/(const BasicVector<T> &left, typename BasicVector<T>::Scalar c) {
+  BasicVector<T> v = left;
   return v /= c;
 }
 
 // friend /////////////////////////////////////////////////////////////////////
 
-std::ostream &operator<<(std::ostream &output, const Vector &a) {
+template <class T>
+std::ostream &operator<<(std::ostream &output, const BasicVector<T> &a) {
   output.setf(std::ios_base::scientific);
   for (int i = 0; i < a.Dim; ++i) {
     output << std::setw(15) << a.ptr[i];
@@ -44,7 +70,8 @@ std::ostream &operator<<(std::ostream &output, const Vector &a) {
 }
 
 
-std::istream &operator>>(std::istream &input, Vector &a) {
+template <class T>
+std::istream &operator>>(std::istream &input, BasicVector<T> &a) {
   std::cout << "Input elements of "<< a.Dim << " dim" << " vector" << "\n";
   for (int i = 0; i < a.Dim; ++i) {
     input >> a.ptr[i];
@@ -53,29 +80,44 @@ std::istream &operator>>(std::istream &input, Vector &a) {
 }
 
 
-double operator*(const Vector &left, const Vector &right) {
+template <class T>
+T operator*(const BasicVector<T> &left, const BasicVector<T> &right) {
   if (left.Dim != right.Dim) {
     std::cout << "error: sizes do not match" << "\n";
     std::abort();
   }
-  double a = 0.0;
-  for (int i = 0; i < left.Dim; ++i) {
+  // one partial sum per SIMD lane so that the reduction vectorizes
+  const int W = ScalarTraits<T>::simdWidth;
+  T acc[W] = {};
+  int i = 0;
+  for (; i + W <= left.Dim; i += W) {
+    for (int k = 0; k < W; ++k) {
+      acc[k] += left.ptr[i+k] * right.ptr[i+k];
+    }
+  }
+  T a = 0.0;
+  for (int k = 0; k < W; ++k) {
+    a += acc[k];
+  }
+  for (; i < left.Dim; ++i) {
     a += left.ptr[i] * right.ptr[i];
   }
   return a;
 }
 
-bool operator==(const Vector &left, const Vector &right) {
+template <class T>
+bool operator==(const BasicVector<T> &left, const BasicVector<T> &right) {
   if (left.Dim != right.Dim) return false;
   for (int i = 0; i < left.Dim; ++i) {
-    if (fabs(left.ptr[i] - right.ptr[i]) > NEARLY_ZERO) {
+    if (std::fabs(left.ptr[i] - right.ptr[i]) > ScalarTraits<T>::nearlyZero()) {
       return false;
     }
   }
   return true;
 }
 
-bool operator!=(const Vector &left, const Vector &right) {
+template <class T>
+bool operator!=(const BasicVector<T> &left, const BasicVector<T> &right) {
   if (left == right) {
     return false;
   } else {
@@ -85,32 +127,37 @@ bool operator!=(const Vector &left, const Vector &right) {
 
 // public /////////////////////////////////////////////////////////////////////
 
-Vector::Vector(int dim): Dim(dim) {
+template <class T>
+BasicVector<T>::BasicVector(int dim): Dim(dim) {
   new_vector();
   for (int i = 0; i < Dim; ++i) {
     ptr[i] = 0.0;
   }
 }
 
-Vector::Vector(const Vector &init) : Dim(init.Dim) {
+template <class T>
+BasicVector<T>::BasicVector(const BasicVector &init) : Dim(init.Dim) {
   new_vector();
   for (int i = 0; i < Dim; ++i) {
     ptr[i] = init.ptr[i];
   }
 }
 
-Vector::Vector(const double *vec, int dim) : Dim(dim) {
+template <class T>
+BasicVector<T>::BasicVector(const T *vec, int dim) : Dim(dim) {
   new_vector();
   for (int i = 0; i < Dim; ++i) {
     ptr[i] = vec[i];
   }
 }
 
-Vector::~Vector(){
+template <class T>
+BasicVector<T>::~BasicVector(){
   del_vector();
 }
 
-void Vector::setSize(int dim) {
+template <class T>
+void BasicVector<T>::setSize(int dim) {
   del_vector();
   Dim = dim;
   new_vector();
@@ -119,24 +166,59 @@ void Vector::setSize(int dim) {
   }
 }
 
-double Vector::norm() const {
-  double a = 0.0;
-  for (int i = 0; i < Dim; ++i) {
-    a += ptr[i] * ptr[i];
+template <class T>
+void BasicVector<T>::shrink(int dim) {
+  if (dim < 0 || dim > Dim) {
+    std::cout << "error: sizes do not match" << "\n";
+    std::abort();
+  }
+  Dim = dim;
+}
+
+template <class T>
+void BasicVector<T>::resize(int dim) {
+  if (dim < 0) {
+    std::cout << "error: sizes do not match" << "\n";
+    std::abort();
+  }
+  if (dim > Cap) {
+    int cap = std::max(dim, 2 * Cap);
+    T *p = new T[cap];
+    std::copy(ptr, ptr + Dim, p);
+    delete [] ptr;
+    ptr = p;
+    Cap = cap;
+  }
+  for (int i = Dim; i < dim; ++i) {
+    ptr[i] = 0.0;
   }
-  return sqrt(a);
+  Dim = dim;
+}
+
+template <class T>
+void BasicVector<T>::swap(BasicVector &other) {
+  std::swap(ptr, other.ptr);
+  std::swap(Dim, other.Dim);
+  std::swap(Cap, other.Cap);
+}
+
+template <class T>
+T BasicVector<T>::norm() const {
+  return std::sqrt((*this) * (*this));
 }
 
-const Vector &Vector::normalize() {
-  double a = norm();
-  if (a < NEARLY_ZERO) return *this;
+template <class T>
+const BasicVector<T> &BasicVector<T>::normalize() {
+  T a = norm();
+  if (a < ScalarTraits<T>::nearlyZero()) return *this;
   for (int i = 0; i < Dim; ++i) {
     ptr[i] /= a;
   }
   return *this;
 }
 
-Vector &Vector::operator=(const Vector &right) {
+template <class T>
+BasicVector<T> &BasicVector<T>::operator=(const BasicVector &right) {
   if (this != &right) {
     if (Dim != right.Dim) std::abort();
     for (int i = 0; i < Dim; ++i) {
@@ -146,15 +228,17 @@ Vector &Vector::operator=(const Vector &right) {
   return *this;
 }
 
-Vector &Vector::operator*=(double c) {
+template <class T>
+BasicVector<T> &BasicVector<T>::operator*=(T c) {
   for (int i = 0; i < Dim; ++i) {
     ptr[i] *= c;
   }
   return *this;
 }
 
-Vector &Vector::operator/=(double c) {
-  if (abs(c) < NEARLY_ZERO) {
+template <class T>
+BasicVector<T> &BasicVector<T>::operator/=(T c) {
+  if (std::fabs(c) < ScalarTraits<T>::nearlyZero()) {
     std::cout << "error: divide by zero" << "\n";
     std::abort();
   }
@@ -164,7 +248,8 @@ Vector &Vector::operator/=(double c) {
   return *this;
 }
 
-Vector &Vector::operator+=(const Vector &right) {
+template <class T>
+BasicVector<T> &BasicVector<T>::operator+=(const BasicVector &right) {
   if (Dim != right.Dim) {
     std::cout << "error: sizes do not match" << "\n";
     std::abort();
@@ -175,7 +260,8 @@ Vector &Vector::operator+=(const Vector &right) {
   return *this;
 }
 
-Vector &Vector::operator-=(const Vector &right) {
+template <class T>
+BasicVector<T> &BasicVector<T>::operator-=(const BasicVector &right) {
   if (Dim != right.Dim) {
     std::cout << "error: sizes do not match" << "\n";
     std::abort();
@@ -186,15 +272,17 @@ Vector &Vector::operator-=(const Vector &right) {
   return *this;
 }
 
-void Vector::cleanup() {
+template <class T>
+void BasicVector<T>::cleanup() {
   int i;
-  double max = 0.0;
+  T max = 0.0;
   for (i = 0; i < Dim; ++i) {
-    if (fabs(ptr[i]) > max) max = fabs(ptr[i]);
+    if (std::fabs(ptr[i]) > max) max = std::fabs(ptr[i]);
   }
-  if (max > NEARLY_ZERO) {
+  if (max > ScalarTraits<T>::nearlyZero()) {
+    const T tol = ScalarTraits<T>::zeroTolerance();
     for (i = 0; i < Dim; ++i) {
-      if (fabs(ptr[i]) / max < ZERO_TOLERANCE) {
+      if (std::fabs(ptr[i]) / max < tol) {
         ptr[i] = 0.0;
       }
     }
@@ -203,19 +291,22 @@ void Vector::cleanup() {
 
 // private ////////////////////////////////////////////////////////////////////
 
-void Vector::new_vector() {
+template <class T>
+void BasicVector<T>::new_vector() {
+  Cap = Dim;
   if (Dim == 0) {
     ptr = 0;
     return;
   }
-  ptr = new double[Dim];
+  ptr = new T[Dim];
   if (ptr == 0) {
     std::cout << "error: failed to allocate memory" << "\n";
     std::abort();
   }
 }
 
-void Vector::del_vector() {
+template <class T>
+void BasicVector<T>::del_vector() {
   delete [] ptr;
 }
 
@@ -223,21 +314,405 @@ void Vector::del_vector() {
 //                                   Matrix                                  //
 ///////////////////////////////////////////////////////////////////////////////
 
+// gemm ///////////////////////////////////////////////////////////////////////
+
+// hardware_concurrency() - 1 workers, started by the first parallel product
+// and kept until exit, so a product does not pay for creating threads. Tasks
+// may come from several threads at once (the solvers call gemm from their own
+// threads); the caller of a product works on it as well, so it never waits
+// for a pool that is busy with someone else's product.
+class GemmPool {
+ public:
+  static GemmPool &instance() {
+    static GemmPool pool;
+    return pool;
+  }
+  int size() const { return (int)workers.size() + 1; }
+  void submit(const std::function<void()> &task) {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      tasks.push_back(task);
+    }
+    ready.notify_one();
+  }
+
+ private:
+  GemmPool() {
+    int n = (int)std::max(1u, std::thread::hardware_concurrency()) - 1;
+    for (int t = 0; t < n; ++t) {
+      workers.push_back(std::thread(&GemmPool::run, this));
+    }
+  }
+  ~GemmPool() {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      stopping = true;
+    }
+    ready.notify_all();
+    for (size_t t = 0; t < workers.size(); ++t) {
+      workers[t].join();
+    }
+  }
+  void run() {
+    for (;;) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> guard(lock);
+        ready.wait(guard, [this]() { return stopping || !tasks.empty(); });
+        if (tasks.empty()) return;
+        task = tasks.front();
+        tasks.pop_front();
+      }
+      task();
+    }
+  }
+  std::mutex lock;
+  std::condition_variable ready;
+  std::deque<std::function<void()> > tasks;
+  bool stopping = false;
+  std::vector<std::thread> workers;
+};
+
+// the bands of rows of C of one product: taken through next, counted in done
+struct GemmBands {
+  int count;
+  std::atomic<int> next;
+  int done;
+  std::mutex lock;
+  std::condition_variable finished;
+};
+
+// pack rows [i0, i0+mc) x cols [p0, p0+kc) of A into MR-row slivers
+template <class T>
+static void pack_a(const BasicVector<T> *a, int i0, int mc, int p0, int kc, T *buf) {
+  for (int ir = 0; ir < mc; ir += GEMM_MR) {
+    int mr = std::min(GEMM_MR, mc - ir);
+    for (int p = 0; p < kc; ++p) {
+      for (int i = 0; i < mr; ++i) {
+        buf[p * GEMM_MR + i] = a[i0 + ir + i][p0 + p];
+      }
+      for (int i = mr; i < GEMM_MR; ++i) {
+        buf[p * GEMM_MR + i] = 0.0;
+      }
+    }
+    buf += kc * GEMM_MR;
+  }
+}
+
+// pack rows [p0, p0+kc) x cols [j0, j0+nc) of B into NR-column slivers
+template <class T>
+static void pack_b(const BasicVector<T> *b, int p0, int kc, int j0, int nc, T *buf) {
+  const int NR = GEMM_NR(T);
+  for (int jr = 0; jr < nc; jr += NR) {
+    int nr = std::min(NR, nc - jr);
+    for (int p = 0; p < kc; ++p) {
+      const T *row = &b[p0 + p][j0 + jr];
+      for (int j = 0; j < nr; ++j) {
+        buf[p * NR + j] = row[j];
+      }
+      for (int j = nr; j < NR; ++j) {
+        buf[p * NR + j] = 0.0;
+      }
+    }
+    buf += kc * NR;
+  }
+}
+
+// C[i0.., j0..] += (packed A sliver) * (packed B sliver), mr x nr valid
+template <class T>
+static void micro_kernel(int kc, const T *a, const T *b,
+                         BasicVector<T> *c, int i0, int j0, int mr, int nr) {
+  const int NR = GEMM_NR(T);
+  T acc[GEMM_MR][NR] = {};
+  for (int p = 0; p < kc; ++p) {
+    for (int i = 0; i < GEMM_MR; ++i) {
+      T ai = a[i];
+      for (int j = 0; j < NR; ++j) {
+        acc[i][j] += ai * b[j];
+      }
+    }
+    a += GEMM_MR;
+    b += NR;
+  }
+  for (int i = 0; i < mr; ++i) {
+    T *row = &c[i0 + i][j0];
+    for (int j = 0; j < nr; ++j) {
+      row[j] += acc[i][j];
+    }
+  }
+}
+
+// C[rows, :] += A[rows, :] * B with the whole of B already packed
+template <class T>
+static void gemm_rows(const BasicVector<T> *a, const T *bpack, BasicVector<T> *c,
+                      int K, int N, int npad, int row_begin, int row_end) {
+  const int NR = GEMM_NR(T);
+  std::vector<T> apack((size_t)GEMM_MC * GEMM_KC);
+  for (int j0 = 0; j0 < N; j0 += GEMM_NC) {
+    int nc = std::min(GEMM_NC, N - j0);
+    for (int p0 = 0; p0 < K; p0 += GEMM_KC) {
+      int kc = std::min(GEMM_KC, K - p0);
+      const T *bblock = bpack + (size_t)p0 * npad + (size_t)j0 * kc;
+      for (int i0 = row_begin; i0 < row_end; i0 += GEMM_MC) {
+        int mc = std::min(GEMM_MC, row_end - i0);
+        pack_a(a, i0, mc, p0, kc, &apack[0]);
+        for (int jr = 0; jr < nc; jr += NR) {
+          for (int ir = 0; ir < mc; ir += GEMM_MR) {
+            micro_kernel(kc, &apack[(size_t)ir * kc], bblock + (size_t)jr * kc,
+                         c, i0 + ir, j0 + jr,
+                         std::min(GEMM_MR, mc - ir), std::min(NR, nc - jr));
+          }
+        }
+      }
+    }
+  }
+}
+
+template <class T>
+void gemm(const BasicMatrix<T> &a, const BasicMatrix<T> &b, BasicMatrix<T> &c) {
+  if (a.Col != b.Row || c.Row != a.Row || c.Col != b.Col) {
+    std::cout << "error: sizes do not match" << "\n";
+    std::abort();
+  }
+  const int NR = GEMM_NR(T);
+  int M = a.Row, K = a.Col, N = b.Col;
+  if (M == 0 || K == 0 || N == 0) return;
+
+  // B is packed once, block by block: the KC x N block starting at row p0
+  // is stored at p0 * npad as consecutive KC x NR slivers
+  int npad = (N + NR - 1) / NR * NR;
+  std::vector<T> bpack((size_t)K * npad);
+  for (int p0 = 0; p0 < K; p0 += GEMM_KC) {
+    int kc = std::min(GEMM_KC, K - p0);
+    for (int j0 = 0; j0 < N; j0 += GEMM_NC) {
+      pack_b(b.ptr, p0, kc, j0, std::min(GEMM_NC, N - j0),
+             &bpack[(size_t)p0 * npad + (size_t)j0 * kc]);
+    }
+  }
+
+  // threads own disjoint bands of rows of C, so no synchronization is needed
+  // on C itself
+  int threads = 1;
+  if (2.0 * M * N * K >= GEMM_PARALLEL_FLOPS) {
+    threads = GemmPool::instance().size();
+    threads = std::min(threads, (M + GEMM_MR - 1) / GEMM_MR);
+  }
+  if (threads == 1) {
+    gemm_rows(a.ptr, &bpack[0], c.ptr, K, N, npad, 0, M);
+    return;
+  }
+  int band = (M + threads - 1) / threads;
+  band = (band + GEMM_MR - 1) / GEMM_MR * GEMM_MR;
+  // a helper that starts after every band is taken only touches bands, which
+  // is why it is shared; a, bpack and c are read only while a band is running
+  std::shared_ptr<GemmBands> bands = std::make_shared<GemmBands>();
+  bands->count = (M + band - 1) / band;
+  bands->next = 0;
+  bands->done = 0;
+  const BasicVector<T> *ap = a.ptr;
+  const T *bp = &bpack[0];
+  BasicVector<T> *cp = c.ptr;
+  std::function<void()> work = [bands, ap, bp, cp, K, N, npad, M, band]() {
+    for (int k = bands->next++; k < bands->count; k = bands->next++) {
+      gemm_rows(ap, bp, cp, K, N, npad, k * band, std::min(M, (k + 1) * band));
+      std::lock_guard<std::mutex> guard(bands->lock);
+      if (++bands->done == bands->count) bands->finished.notify_all();
+    }
+  };
+  for (int t = 1; t < threads; ++t) {
+    GemmPool::instance().submit(work);
+  }
+  work();
+  std::unique_lock<std::mutex> guard(bands->lock);
+  bands->finished.wait(guard, [&bands]() { return bands->done == bands->count; });
+}
+
 // not member /////////////////////////////////////////////////////////////////
 
-const Matrix operator+(const Matrix &left, const Matrix &right) {
-  Matrix m = left;
+template <class T>
+const BasicMatrix<T> operator+(const BasicMatrix<T> &left, const BasicMatrix<T> &right) {
+  BasicMatrix<T> m = left;
   return m += right;
 }
 
-const Matrix operator-(const Matrix &left, const Matrix &right) {
-  Matrix m = left;
+template <class T>
+const BasicMatrix<T> operator-(const BasicMatrix<T> &left, const BasicMatrix<T> &right) {
+  BasicMatrix<T> m = left;
   return m -= right;
 }
 
+template <class T>
+bool cholesky(BasicMatrix<T> &a) {
+  int n = a.getRow();
+  if (a.getCol() != n) {
+    std::cout << "error: sizes do not match" << "\n";
+    std::abort();
+  }
+  bool pd = true;
+  T dmax = 0.0;
+  for (int j = 0; j < n; ++j) {
+    if (a[j][j] > dmax) dmax = a[j][j];
+  }
+  // pivots this small relative to the diagonal are replaced by a huge value,
+  // which zeroes the corresponding component of the solution
+  const T tiny = dmax * std::numeric_limits<T>::epsilon();
+  for (int j = 0; j < n; ++j) {
+    T *lj = &a[j][0];
+    T d = lj[j];
+    for (int k = 0; k < j; ++k) {
+      d -= lj[k] * lj[k];
+    }
+    if (d <= tiny) {
+      pd = false;
+      d = std::numeric_limits<T>::max() / (n + 1);
+    }
+    lj[j] = std::sqrt(d);
+    for (int i = j + 1; i < n; ++i) {
+      T *li = &a[i][0];
+      T sum = li[j];
+      for (int k = 0; k < j; ++k) {
+        sum -= li[k] * lj[k];
+      }
+      li[j] = sum / lj[j];
+    }
+  }
+  return pd;
+}
+
+template <class T>
+void choleskySolve(const BasicMatrix<T> &l, BasicVector<T> &x) {
+  int n = l.getRow();
+  if (x.getSize() != n) {
+    std::cout << "error: sizes do not match" << "\n";
+    std::abort();
+  }
+  // Ly = b
+  for (int i = 0; i < n; ++i) {
+    const T *li = &l[i][0];
+    T sum = x[i];
+    for (int k = 0; k < i; ++k) {
+      sum -= li[k] * x[k];
+    }
+    x[i] = sum / li[i];
+  }
+  // L^Tx = y
+  for (int i = n - 1; i >= 0; --i) {
+    T sum = x[i];
+    for (int k = i + 1; k < n; ++k) {
+      sum -= l[k][i] * x[k];
+    }
+    x[i] = sum / l[i][i];
+  }
+}
+
+template <class T>
+bool lu(BasicMatrix<T> &a, std::vector<int> &perm) {
+  int n = a.getRow();
+  if (a.getCol() != n) {
+    std::cout << "error: sizes do not match" << "\n";
+    std::abort();
+  }
+  perm.resize(n);
+  T amax = 0.0;
+  for (int i = 0; i < n; ++i) {
+    perm[i] = i;
+    for (int j = 0; j < n; ++j) {
+      if (std::fabs(a[i][j]) > amax) amax = std::fabs(a[i][j]);
+    }
+  }
+  const T tiny = amax * n * std::numeric_limits<T>::epsilon();
+  for (int k = 0; k < n; ++k) {
+    int p = k;
+    for (int i = k + 1; i < n; ++i) {
+      if (std::fabs(a[i][k]) > std::fabs(a[p][k])) p = i;
+    }
+    if (!(std::fabs(a[p][k]) > tiny)) return false;
+    if (p != k) {
+      for (int j = 0; j < n; ++j) {
+        T t = a[p][j];
+        a[p][j] = a[k][j];
+        a[k][j] = t;
+      }
+      int t = perm[p];
+      perm[p] = perm[k];
+      perm[k] = t;
+    }
+    const T *ak = &a[k][0];
+    for (int i = k + 1; i < n; ++i) {
+      T *ai = &a[i][0];
+      T l = ai[k] / ak[k];
+      ai[k] = l;
+      if (l == 0) continue;
+      for (int j = k + 1; j < n; ++j) {
+        ai[j] -= l * ak[j];
+      }
+    }
+  }
+  return true;
+}
+
+template <class T>
+void luSolve(const BasicMatrix<T> &lu, const std::vector<int> &perm, BasicVector<T> &x) {
+  int n = lu.getRow();
+  if (x.getSize() != n || (int)perm.size() != n) {
+    std::cout << "error: sizes do not match" << "\n";
+    std::abort();
+  }
+  BasicVector<T> y(n);
+  // Ly = Pb
+  for (int i = 0; i < n; ++i) {
+    const T *li = &lu[i][0];
+    T sum = x[perm[i]];
+    for (int k = 0; k < i; ++k) {
+      sum -= li[k] * y[k];
+    }
+    y[i] = sum;
+  }
+  // Ux = y
+  for (int i = n - 1; i >= 0; --i) {
+    const T *ui = &lu[i][0];
+    T sum = y[i];
+    for (int k = i + 1; k < n; ++k) {
+      sum -= ui[k] * y[k];
+    }
+    y[i] = sum / ui[i];
+  }
+  x.swap(y);
+}
+
+template <class T>
+void luSolveTransposed(const BasicMatrix<T> &lu, const std::vector<int> &perm, BasicVector<T> &x) {
+  int n = lu.getRow();
+  if (x.getSize() != n || (int)perm.size() != n) {
+    std::cout << "error: sizes do not match" << "\n";
+    std::abort();
+  }
+  // A^T = U^TL^TP なので U^Tz = b, L^Tw = z, x = P^Tw
+  for (int i = 0; i < n; ++i) {
+    T sum = x[i];
+    for (int k = 0; k < i; ++k) {
+      sum -= lu[k][i] * x[k];
+    }
+    x[i] = sum / lu[i][i];
+  }
+  for (int i = n - 1; i >= 0; --i) {
+    T sum = x[i];
+    for (int k = i + 1; k < n; ++k) {
+      sum -= lu[k][i] * x[k];
+    }
+    x[i] = sum;
+  }
+  BasicVector<T> y(n);
+  for (int i = 0; i < n; ++i) {
+    y[perm[i]] = x[i];
+  }
+  x.swap(y);
+}
+
 // friend /////////////////////////////////////////////////////////////////////
 
-std::istream& operator>>(std::istream& input, Matrix& a) {
+template <class T>
+std::istream& operator>>(std::istream& input, BasicMatrix<T>& a) {
   std::cout << "Input elements of "<< a.Row << "x" << a.Col << " matrix" << "\n";
   for (int i = 0; i < a.Row; ++i) {
     std::cout << "row:" << (i+1) << "\n";
@@ -246,7 +721,8 @@ std::istream& operator>>(std::istream& input, Matrix& a) {
   return input;
 }
 
-std::ostream& operator<<(std::ostream& output, const Matrix& a) {
+template <class T>
+std::ostream& operator<<(std::ostream& output, const BasicMatrix<T>& a) {
   output.setf(std::ios_base::scientific);
   for (int i = 0; i < a.Row; ++i) {
     output << a.ptr[i];
@@ -254,31 +730,29 @@ std::ostream& operator<<(std::ostream& output, const Matrix& a) {
   return output;
 }
 
-const Vector operator*(const Matrix &a, const Vector &x) {
+template <class T>
+const BasicVector<T> operator*(const BasicMatrix<T> &a, const BasicVector<T> &x) {
   if (a.Col != x.getSize()) {
     std::cout << "error: sizes do not match" << "\n";
     std::abort();
   }
-  Vector y(a.Row);
+  BasicVector<T> y(a.Row);
   for (int i = 0; i < a.Row; ++i) {
-    double sum = 0.0;
-    for (int j = 0; j < a.Col; ++j) {
-      sum += a.ptr[i].ptr[j] * x.ptr[j];
-    }
-    y.ptr[i] = sum;
+    y.ptr[i] = a.ptr[i] * x;
   }
   y.cleanup();
   return y;
 }
 
-const Vector operator*(const Vector &x, const Matrix &a) {
+template <class T>
+const BasicVector<T> operator*(const BasicVector<T> &x, const BasicMatrix<T> &a) {
   if (a.Row != x.getSize()) {
     std::cout << "error: sizes do not match" << "\n";
     std::abort();
   }
-  Vector y(a.Col);
+  BasicVector<T> y(a.Col);
   for (int i = 0; i < a.Col; ++i) {
-    double sum = 0.0;
+    T sum = 0.0;
     for (int j = 0; j < a.Row; ++j) {
       sum += x.ptr[j] * a.ptr[j].ptr[i];
     }
@@ -288,26 +762,20 @@ const Vector operator*(const Vector &x, const Matrix &a) {
   return y;
 }
 
-const Matrix operator*(const Matrix &left, const Matrix &right) {
+template <class T>
+const BasicMatrix<T> operator*(const BasicMatrix<T> &left, const BasicMatrix<T> &right) {
   if (left.Col != right.Row) {
     std::cout << "error: sizes do not match" << "\n";
     std::abort();
   }
-  Matrix m(left.Row, right.Col);
-  for (int i = 0; i < left.Row; ++i) {
-    for (int j = 0; j < right.Col; ++j) {
-      double sum = 0.0;
-      for (int k = 0; k < left.Col; ++k) {
-        sum += left.ptr[i].ptr[k] * right.ptr[k].ptr[j];
-      }
-      m.ptr[i].ptr[j] = sum;
-    }
-  }
+  BasicMatrix<T> m(left.Row, right.Col);
+  gemm(left, right, m);
   m.cleanup();
   return m;
 }
 
-bool operator==(const Matrix &left, const Matrix &right) {
+template <class T>
+bool operator==(const BasicMatrix<T> &left, const BasicMatrix<T> &right) {
   if (left.Row != right.Row || left.Col != right.Col) {
     return false;
   }
@@ -319,7 +787,8 @@ bool operator==(const Matrix &left, const Matrix &right) {
   return true;
 }
 
-bool operator!=(const Matrix &left, const Matrix &right) {
+template <class T>
+bool operator!=(const BasicMatrix<T> &left, const BasicMatrix<T> &right) {
   if (left == right) {
     return false;
   } else {
@@ -330,29 +799,93 @@ bool operator!=(const Matrix &left, const Matrix &right) {
 
 // public /////////////////////////////////////////////////////////////////////
 
-Matrix::Matrix(int row, int col): Row(row), Col(col) {
+template <class T>
+BasicMatrix<T>::BasicMatrix(int row, int col): Row(row), Col(col) {
   new_matrix();
 }
 
-Matrix::Matrix(const Matrix &init): Row(init.Row), Col(init.Col) {
+template <class T>
+BasicMatrix<T>::BasicMatrix(const BasicMatrix &init): Row(init.Row), Col(init.Col) {
   new_matrix();
   for (int i = 0; i < Row; ++i) {
     ptr[i] = init.ptr[i];
   }
 }
 
-Matrix::~Matrix() {
+template <class T>
+BasicMatrix<T>::~BasicMatrix() {
   del_matrix();
 }
 
-void Matrix::setSize(int row, int col) {
+template <class T>
+void BasicMatrix<T>::setSize(int row, int col) {
   del_matrix();
   Row = row;
   Col = col;
   new_matrix();
 }
 
-Matrix &Matrix::operator=(const Matrix &right) {
+template <class T>
+void BasicMatrix<T>::shrink(int row, int col) {
+  if (row < 0 || row > Row || col < 0 || col > Col) {
+    std::cout << "error: sizes do not match" << "\n";
+    std::abort();
+  }
+  for (int i = row; i < Row; ++i) {
+    ptr[i].setSize(0);
+  }
+  for (int i = 0; i < row; ++i) {
+    ptr[i].shrink(col);
+  }
+  Row = row;
+  Col = col;
+}
+
+template <class T>
+void BasicMatrix<T>::insertColumns(int col, int k) {
+  if (col < 0 || col > Col || k < 0) {
+    std::cout << "error: sizes do not match" << "\n";
+    std::abort();
+  }
+  for (int i = 0; i < Row; ++i) {
+    ptr[i].resize(Col + k);
+    T *r = &ptr[i][0];
+    std::copy_backward(r + col, r + Col, r + Col + k);
+    std::fill(r + col, r + col + k, T(0));
+  }
+  if (Row > 0) Col += k;
+}
+
+template <class T>
+void BasicMatrix<T>::insertRows(int row, int k) {
+  if (row < 0 || row > Row || k < 0) {
+    std::cout << "error: sizes do not match" << "\n";
+    std::abort();
+  }
+  BasicVector<T> *p = new BasicVector<T>[Row + k];
+  for (int i = 0; i < row; ++i) {
+    p[i].swap(ptr[i]);
+  }
+  for (int i = row; i < Row; ++i) {
+    p[i + k].swap(ptr[i]);
+  }
+  for (int i = row; i < row + k; ++i) {
+    p[i].setSize(Col);
+  }
+  delete [] ptr;
+  ptr = p;
+  Row += k;
+}
+
+template <class T>
+void BasicMatrix<T>::swap(BasicMatrix &other) {
+  std::swap(ptr, other.ptr);
+  std::swap(Row, other.Row);
+  std::swap(Col, other.Col);
+}
+
+template <class T>
+BasicMatrix<T> &BasicMatrix<T>::operator=(const BasicMatrix &right) {
   if (this != &right) {
     if ((Row != right.Row) || (Col != right.Col)) {
       std::abort();
@@ -364,7 +897,8 @@ Matrix &Matrix::operator=(const Matrix &right) {
   return *this;
 }
 
-Matrix &Matrix::operator+=(const Matrix &right) {
+template <class T>
+BasicMatrix<T> &BasicMatrix<T>::operator+=(const BasicMatrix &right) {
   if (Row != right.Row || Col != right.Col) {
     std::cout << "error: sizes do not match" << "\n";
     std::abort();
@@ -375,7 +909,8 @@ Matrix &Matrix::operator+=(const Matrix &right) {
   return *this;
 }
 
-Matrix &Matrix::operator-=(const Matrix &right) {
+template <class T>
+BasicMatrix<T> &BasicMatrix<T>::operator-=(const BasicMatrix &right) {
   if (Row != right.Row || Col != right.Col) {
     std::cout << "error: sizes do not match" << "\n";
     std::abort();
@@ -386,56 +921,65 @@ Matrix &Matrix::operator-=(const Matrix &right) {
   return *this;
 }
 
-Matrix &Matrix::operator*=(const Matrix &right) {
+template <class T>
+BasicMatrix<T> &BasicMatrix<T>::operator*=(const BasicMatrix &right) {
   if ((Col != right.Row) || (Col != right.Col)) {
     std::cout << "error: sizes do not match" << "\n";
     std::abort();
   }
+  return *this = *this * right;
+}
 
-  Matrix m(Row, right.Col);
+template <class T>
+void BasicMatrix<T>::cleanup() {
+  // blocks of one SIMD register so that both passes vectorize
+  const int W = ScalarTraits<T>::simdWidth;
+  T acc[W] = {};
   for (int i = 0; i < Row; ++i) {
-    for (int j = 0; j < right.Col; ++j) {
-      double sum = 0.0;
-      for (int k = 0; j < Col; ++k) {
-        sum += ptr[i][k] * right.ptr[k][j];
+    const T *r = &ptr[i][0];
+    int j = 0;
+    for (; j + W <= Col; j += W) {
+      for (int k = 0; k < W; ++k) {
+        acc[k] = std::max(acc[k], (T)std::fabs(r[j+k]));
       }
-      m.ptr[i][j] = sum;
     }
-  }
-  m.cleanup();
-
-  return *this = m;
-}
-
-void Matrix::cleanup() {
-  int i, j;
-  double max = 0.0;
-  for (i = 0; i < Row; ++i) {
-    for (j = 0; j < Col; ++j) {
-      if (fabs(ptr[i][j]) > max) max = fabs(ptr[i][j]);
+    for (; j < Col; ++j) {
+      acc[0] = std::max(acc[0], (T)std::fabs(r[j]));
     }
   }
-  if (max > NEARLY_ZERO) {
-    for (i = 0; i < Row; ++i) {
-      for (j = 0; j < Col; ++j) {
-        if (fabs(ptr[i][j]) / max < ZERO_TOLERANCE) {
-          ptr[i][j] = 0.0;
+  T max = 0.0;
+  for (int k = 0; k < W; ++k) {
+    max = std::max(max, acc[k]);
+  }
+  if (max > ScalarTraits<T>::nearlyZero()) {
+    // |x| / max < tol
+    const T threshold = ScalarTraits<T>::zeroTolerance() * max;
+    for (int i = 0; i < Row; ++i) {
+      T *r = &ptr[i][0];
+      int j = 0;
+      for (; j + W <= Col; j += W) {
+        for (int k = 0; k < W; ++k) {
+          r[j+k] = std::fabs(r[j+k]) < threshold ? T(0) : r[j+k];
         }
       }
+      for (; j < Col; ++j) {
+        if (std::fabs(r[j]) < threshold) r[j] = 0.0;
+      }
     }
   }
 }
 
 // private ////////////////////////////////////////////////////////////////////
 
-void Matrix::new_matrix() {
+template <class T>
+void BasicMatrix<T>::new_matrix() {
   if (Row == 0 || Col == 0) {
     Row = 0;
     Col = 0;
     ptr = 0;
     return;
   }
-  ptr = new Vector[Row];
+  ptr = new BasicVector<T>[Row];
   if (ptr == 0) {
     std::cout << "error: failed to allocate memory" << "\n";
     std::abort();
@@ -445,6 +989,44 @@ void Matrix::new_matrix() {
   }
 }
 
-void Matrix::del_matrix() {
+template <class T>
+void BasicMatrix<T>::del_matrix() {
   delete [] ptr;
 }
+
+///////////////////////////////////////////////////////////////////////////////
+//                          explicit instantiation                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#define INSTANTIATE_MATRIX(T)                                                  \
+  template class BasicVector<T>;                                               \
+  template class BasicMatrix<T>;                                               \
+  template const BasicVector<T> operator+(const BasicVector<T> &, const BasicVector<T> &); \
+  template const BasicVector<T> operator-(const BasicVector<T> &, const BasicVector<T> &); \
+  template const BasicVector<T> operator*(T, const BasicVector<T> &);          \
+  template const BasicVector<T> operator*(const BasicVector<T> &, T);          \
+  template const BasicVector<T> operator/(const BasicVector<T> &, T);          \
+  template std::ostream &operator<<(std::ostream &, const BasicVector<T> &);   \
+  template std::istream &operator>>(std::istream &, BasicVector<T> &);         \
+  template T operator*(const BasicVector<T> &, const BasicVector<T> &);        \
+  template bool operator==(const BasicVector<T> &, const BasicVector<T> &);    \
+  template bool operator!=(const BasicVector<T> &, const BasicVector<T> &);    \
+  template const BasicMatrix<T> operator+(const BasicMatrix<T> &, const BasicMatrix<T> &); \
+  template const BasicMatrix<T> operator-(const BasicMatrix<T> &, const BasicMatrix<T> &); \
+  template void gemm(const BasicMatrix<T> &, const BasicMatrix<T> &, BasicMatrix<T> &); \
+  template bool cholesky(BasicMatrix<T> &);                                    \
+  template void choleskySolve(const BasicMatrix<T> &, BasicVector<T> &);       \
+  template bool lu(BasicMatrix<T> &, std::vector<int> &);                      \
+  template void luSolve(const BasicMatrix<T> &, const std::vector<int> &, BasicVector<T> &); \
+  template void luSolveTransposed(const BasicMatrix<T> &, const std::vector<int> &, BasicVector<T> &); \
+  template std::ostream &operator<<(std::ostream &, const BasicMatrix<T> &);   \
+  template std::istream &operator>>(std::istream &, BasicMatrix<T> &);         \
+  template const BasicVector<T> operator*(const BasicMatrix<T> &, const BasicVector<T> &); \
+  template const BasicVector<T> operator*(const BasicVector<T> &, const BasicMatrix<T> &); \
+  template const BasicMatrix<T> operator*(const BasicMatrix<T> &, const BasicMatrix<T> &); \
+  template bool operator==(const BasicMatrix<T> &, const BasicMatrix<T> &);    \
+  template bool operator!=(const BasicMatrix<T> &, const BasicMatrix<T> &);
+
+INSTANTIATE_MATRIX(float)
+INSTANTIATE_MATRIX(double)
+INSTANTIATE_MATRIX(long double)
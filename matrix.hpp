@@ -3,87 +3,184 @@
 #include <iomanip>
 #include <cstdlib>
 #include <cmath>
+#include <limits>
+#include <vector>
 #define NDEBUG
 #include <cassert>
 
-#define NEARLY_ZERO 1.E-10
-#define ZERO_TOLERANCE 1.E-12
-
-class Vector;
-class Matrix;
-
-const Vector operator+(const Vector &, const Vector &);
-const Vector operator-(const Vector &, const Vector &);
-const Vector operator*(double, const Vector &);
-const Vector operator*(const Vector &, double);
-const Vector operator/(const Vector &, double);
-
-class Vector {
-  friend std::ostream &operator<<(std::ostream &, const Vector &);
-  friend std::istream &operator>>(std::istream &, Vector &);
-  friend double operator*(const Vector &, const Vector &);
-  friend const Matrix operator*(const Matrix &, const Matrix &);
-  friend const Vector operator*(const Matrix &, const Vector &);
-  friend const Vector operator*(const Vector &, const Matrix &);
-  friend bool operator==(const Vector &, const Vector &);
-  friend bool operator!=(const Vector &, const Vector &);
-  
+// width of the widest SIMD register of the target in bytes
+#if defined(__AVX512F__)
+#define SIMD_BYTES 64
+#elif defined(__AVX__)
+#define SIMD_BYTES 32
+#elif defined(__SSE2__) || defined(__ARM_NEON)
+#define SIMD_BYTES 16
+#else
+#define SIMD_BYTES 0
+#endif
+
+/* number of lanes of T in one SIMD register (1 if T is not vectorizable) */
+template <class T>
+struct SimdWidth {
+  static const int value =
+      (SIMD_BYTES / (int)sizeof(T) > 0) ? SIMD_BYTES / (int)sizeof(T) : 1;
+};
+
+// x87 long double has no SIMD form
+template <>
+struct SimdWidth<long double> {
+  static const int value = 1;
+};
+
+/* tolerances and vector width of a scalar type */
+template <class T>
+struct ScalarTraits {
+  static const int simdWidth = SimdWidth<T>::value;
+  // |x| below this is treated as zero (eps^(5/8), ~1.6E-10 for double)
+  static T nearlyZero() {
+    static const T value = std::pow(std::numeric_limits<T>::epsilon(), T(0.625));
+    return value;
+  }
+  // entries this small relative to the largest one are cleaned up
+  // (eps^(3/4), ~1.8E-12 for double)
+  static T zeroTolerance() {
+    static const T value = std::pow(std::numeric_limits<T>::epsilon(), T(0.75));
+    return value;
+  }
+};
+
+template <class T> class BasicVector;
+template <class T> class BasicMatrix;
+
+typedef BasicVector<double> Vector;
+typedef BasicMatrix<double> Matrix;
+
+template <class T>
+const BasicVector<T> operator+(const BasicVector<T> &, const BasicVector<T> &);
+template <class T>
+const BasicVector<T> operator-(const BasicVector<T> &, const BasicVector<T> &);
+template <class T>
+const BasicVector<T> operator*(typename BasicVector<T>::Scalar, const BasicVector<T> &);
+template <class T>
+const BasicVector<T> operator*(const BasicVector<T> &, typename BasicVector<T>::Scalar);
+template <class T>
+const BasicVector<T> operator/(const BasicVector<T> &, typename BasicVector<T>::Scalar);
+
+template <class T> std::ostream &operator<<(std::ostream &, const BasicVector<T> &);
+template <class T> std::istream &operator>>(std::istream &, BasicVector<T> &);
+template <class T> T operator*(const BasicVector<T> &, const BasicVector<T> &);
+template <class T> bool operator==(const BasicVector<T> &, const BasicVector<T> &);
+template <class T> bool operator!=(const BasicVector<T> &, const BasicVector<T> &);
+
+template <class T>
+const BasicMatrix<T> operator+(const BasicMatrix<T> &, const BasicMatrix<T> &);
+template <class T>
+const BasicMatrix<T> operator-(const BasicMatrix<T> &, const BasicMatrix<T> &);
+template <class T> /* C += A * B */
+void gemm(const BasicMatrix<T> &, const BasicMatrix<T> &, BasicMatrix<T> &);
+
+/* overwrite the lower triangle of a symmetric positive definite matrix with
+   its Cholesky factor L (A = LL^T); false if A is not numerically PD */
+template <class T> bool cholesky(BasicMatrix<T> &);
+/* solve LL^T x = b in place with the factor from cholesky() */
+template <class T> void choleskySolve(const BasicMatrix<T> &, BasicVector<T> &);
+/* overwrite a square matrix with its LU factors with partial pivoting
+   (PA = LU, unit lower L); perm[i] is the row of A in row i of PA.
+   false if a pivot is zero relative to the largest entry (A is singular) */
+template <class T> bool lu(BasicMatrix<T> &, std::vector<int> &);
+/* solve Ax = b (luSolve) or A^Tx = b (luSolveTransposed) in place with the
+   factors from lu() */
+template <class T> void luSolve(const BasicMatrix<T> &, const std::vector<int> &, BasicVector<T> &);
+template <class T> void luSolveTransposed(const BasicMatrix<T> &, const std::vector<int> &, BasicVector<T> &);
+
+template <class T> std::ostream &operator<<(std::ostream &, const BasicMatrix<T> &);
+template <class T> std::istream &operator>>(std::istream &, BasicMatrix<T> &);
+template <class T>
+const BasicVector<T> operator*(const BasicMatrix<T> &, const BasicVector<T> &);
+template <class T>
+const BasicVector<T> operator*(const BasicVector<T> &, const BasicMatrix<T> &);
+template <class T>
+const BasicMatrix<T> operator*(const BasicMatrix<T> &, const BasicMatrix<T> &);
+template <class T> bool operator==(const BasicMatrix<T> &, const BasicMatrix<T> &);
+template <class T> bool operator!=(const BasicMatrix<T> &, const BasicMatrix<T> &);
+
+template <class T>
+class BasicVector {
+  friend std::ostream &operator<< <>(std::ostream &, const BasicVector &);
+  friend std::istream &operator>> <>(std::istream &, BasicVector &);
+  friend T operator* <>(const BasicVector &, const BasicVector &);
+  friend const BasicMatrix<T> operator* <>(const BasicMatrix<T> &, const BasicMatrix<T> &);
+  friend const BasicVector operator* <>(const BasicMatrix<T> &, const BasicVector &);
+  friend const BasicVector operator* <>(const BasicVector &, const BasicMatrix<T> &);
+  friend bool operator== <>(const BasicVector &, const BasicVector &);
+  friend bool operator!= <>(const BasicVector &, const BasicVector &);
+
  public:
-  explicit Vector(int = 0);
-  Vector(const Vector &);
-  Vector(const double *, int);
-  ~Vector();
+  typedef T Scalar;
+
+  explicit BasicVector(int = 0);
+  BasicVector(const BasicVector &);
+  BasicVector(const T *, int);
+  ~BasicVector();
   void setSize(int);
+  void shrink(int);             /* drop trailing elements, keep the storage */
+  void resize(int);             /* keep the elements, new ones are 0; storage grows geometrically */
+  void swap(BasicVector &);     /* exchange the storage, O(1) */
   int getSize() const { return Dim; }
-  double norm() const;
-  const Vector &normalize();
-  Vector &operator=(const Vector &);
-  double &operator[](int);
-  const double &operator[](int) const;
-  const Vector operator-() const {return -1.0*(*this);}
-  Vector &operator*=(double);
-  Vector &operator/=(double);
-  Vector &operator+=(const Vector &);
-  Vector &operator-=(const Vector &);
+  T norm() const;
+  const BasicVector &normalize();
+  BasicVector &operator=(const BasicVector &);
+  T &operator[](int);
+  const T &operator[](int) const;
+  const BasicVector operator-() const {return T(-1)*(*this);}
+  BasicVector &operator*=(T);
+  BasicVector &operator/=(T);
+  BasicVector &operator+=(const BasicVector &);
+  BasicVector &operator-=(const BasicVector &);
   void cleanup();
 
  private:
-  double *ptr;
+  T *ptr;
   int Dim;
+  int Cap;                      /* allocated elements (\geq Dim) */
   void new_vector();
   void del_vector();
 };
 
+template <class T>
+class BasicMatrix {
+  friend std::ostream &operator<< <>(std::ostream &, const BasicMatrix &);
+  friend std::istream &operator>> <>(std::istream &, BasicMatrix &);
+  friend const BasicVector<T> operator* <>(const BasicMatrix &, const BasicVector<T> &);
+  friend const BasicVector<T> operator* <>(const BasicVector<T> &, const BasicMatrix &);
+  friend const BasicMatrix operator* <>(const BasicMatrix &, const BasicMatrix &);
+  friend bool operator== <>(const BasicMatrix &, const BasicMatrix &);
+  friend bool operator!= <>(const BasicMatrix &, const BasicMatrix &);
+  friend void gemm <>(const BasicMatrix &, const BasicMatrix &, BasicMatrix &);
 
-const Matrix operator+(const Matrix &, const Matrix &);
-const Matrix operator-(const Matrix &, const Matrix &);
-
-class Matrix {
-  friend std::ostream &operator<<(std::ostream &, const Matrix &);
-  friend std::istream &operator>>(std::istream &, Matrix &);
-  friend const Vector operator*(const Matrix &, const Vector &);
-  friend const Vector operator*(const Vector &, const Matrix &);
-  friend const Matrix operator*(const Matrix &, const Matrix &);
-  friend bool operator==(const Matrix &, const Matrix &);
-  friend bool operator!=(const Matrix &, const Matrix &);
-  
  public:
-  explicit Matrix(int = 0, int = 0);     /* default constructor */
-  Matrix(const Matrix &);       /* copy constructor */
-  ~Matrix();                    /* destructor */
+  typedef T Scalar;
+
+  explicit BasicMatrix(int = 0, int = 0);     /* default constructor */
+  BasicMatrix(const BasicMatrix &);       /* copy constructor */
+  ~BasicMatrix();                    /* destructor */
   void setSize(int, int);
+  void shrink(int, int);        /* drop trailing rows and columns in place */
+  void insertColumns(int, int); /* insert k zero columns before column j in place */
+  void insertRows(int, int);    /* insert k zero rows before row i, rows are not copied */
+  void swap(BasicMatrix &);     /* exchange the storage, O(1) */
   int getRow() const {return Row;}
   int getCol() const {return Col;}
-  Matrix &operator=(const Matrix &);
-  Vector &operator[](int);
-  const Vector &operator[](int) const;
-  Matrix &operator+=(const Matrix &);
-  Matrix &operator-=(const Matrix &);
-  Matrix &operator*=(const Matrix &);
+  BasicMatrix &operator=(const BasicMatrix &);
+  BasicVector<T> &operator[](int);
+  const BasicVector<T> &operator[](int) const;
+  BasicMatrix &operator+=(const BasicMatrix &);
+  BasicMatrix &operator-=(const BasicMatrix &);
+  BasicMatrix &operator*=(const BasicMatrix &);
   void cleanup();
 
  private:
-  Vector *ptr;
+  BasicVector<T> *ptr;
   int Row;
   int Col;
 
@@ -92,23 +189,26 @@ class Matrix {
   void del_matrix();            /* release memory */
 };
 
-inline double &Vector::operator[](int i) {
+template <class T>
+inline T &BasicVector<T>::operator[](int i) {
   assert(i >= 0 && i < Dim);
   return ptr[i];
 }
 
-inline const double &Vector::operator[](int i) const {
+template <class T>
+inline const T &BasicVector<T>::operator[](int i) const {
   assert(i >= 0 && i < Dim);
   return ptr[i];
 }
 
-inline Vector &Matrix::operator[](int i) {
+template <class T>
+inline BasicVector<T> &BasicMatrix<T>::operator[](int i) {
   assert(i >= 0 && i < Row);
   return ptr[i];
 }
 
-inline const Vector &Matrix::operator[](int i) const {
+template <class T>
+inline const BasicVector<T> &BasicMatrix<T>::operator[](int i) const {
   assert(i >= 0 && i < Row);
   return ptr[i];
 }
-
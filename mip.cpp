@@ -0,0 +1,348 @@
+#include "mip.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// 節点の表と基底
+template <class T>
+struct MIPTableau {
+  BasicMatrix<T> All;
+  Basis basis;
+};
+
+// 根の問題に加える分枝の制約 x_var \leq bound (upなら -x_var \leq -bound)
+template <class T>
+struct MIPBound {
+  int var;
+  T bound;
+  bool up;
+};
+
+// 節点は表を持たず, 根からの分枝の制約だけを持つ(変数と向きごとに一番
+// きついもの一つなので, 深さではなく整数変数の数で抑えられる)
+template <class T>
+struct MIPNode {
+  std::vector<MIPBound<T> > bounds;
+  long parent;                  /* 親の節点の番号(根は0) */
+  T lpBound;                    /* 親のLPの最適値(この節点の上界) */
+};
+
+// 一つのスレッドの未処理の節点. 持ち主は pop, 他のスレッドは steal で取る
+template <class T>
+class NodePool {
+ public:
+  explicit NodePool(NodeSelection selection) : selection(selection) {}
+
+  void push(MIPNode<T> node) {
+    std::lock_guard<std::mutex> lock(mutex);
+    nodes.push_back(std::move(node));
+    if (selection == MIP_BEST_BOUND) std::push_heap(nodes.begin(), nodes.end(), worse);
+  }
+
+  bool pop(MIPNode<T> &node) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (nodes.empty()) return false;
+    if (selection == MIP_BEST_BOUND) std::pop_heap(nodes.begin(), nodes.end(), worse);
+    node = std::move(nodes.back());
+    nodes.pop_back();
+    return true;
+  }
+
+  // 最良優先なら一番良い節点, 深さ優先なら一番古い(根に近い)節点を取る
+  bool steal(MIPNode<T> &node) {
+    if (selection == MIP_BEST_BOUND) return pop(node);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (nodes.empty()) return false;
+    node = std::move(nodes.front());
+    nodes.pop_front();
+    return true;
+  }
+
+ private:
+  static bool worse(const MIPNode<T> &p, const MIPNode<T> &q) { return p.lpBound < q.lpBound; }
+
+  NodeSelection selection;
+  std::mutex mutex;
+  std::deque<MIPNode<T> > nodes;
+};
+
+// 全スレッドで共有する探索の状態
+template <class T>
+struct MIPSearch {
+  const std::vector<bool> &integer;
+  const MIPOptions<T> &opt;
+  MIPTableau<T> root;           /* 根の最適な表(読むだけ) */
+  std::vector<std::unique_ptr<NodePool<T> > > pools;
+  std::atomic<long> pending;    /* 積まれてまだ処理の終わっていない節点 */
+  std::atomic<long> queued;     /* poolに積まれている節点 */
+  std::atomic<long> solved;
+  std::atomic<bool> stop;
+  std::atomic<int> stopStatus;  /* 止めた理由(maxNodesか節点のLPの予算) */
+  std::mutex idleMutex;         /* 節点のないスレッドはidleで待つ */
+  std::condition_variable idle;
+  // 暫定解は全スレッドで一つ. 値の写しincumbentで枝刈りし, x, f, foundはincumbentMutexで守る
+  std::atomic<double> incumbent;
+  std::mutex incumbentMutex;
+  BasicVector<T> x;
+  T f;
+  bool found;
+
+  MIPSearch(const std::vector<bool> &integer, const MIPOptions<T> &opt)
+      : integer(integer), opt(opt), pending(0), queued(0), solved(0), stop(false),
+        stopStatus(SOLVE_ITERATION_LIMIT), incumbent(-std::numeric_limits<double>::infinity()), f(0),
+        found(false) {}
+
+  bool pruned(T bound) const {
+    double inc = incumbent.load();
+    return bound <= inc + ScalarTraits<T>::nearlyZero() * (1 + std::fabs(inc));
+  }
+
+  // 待っているスレッドを起こす(条件を変えてから呼ぶ)
+  void wake() {
+    std::lock_guard<std::mutex> lock(idleMutex);
+    idle.notify_all();
+  }
+};
+
+// スレッドが解いて子を積んだ節点の表. 子は親の表をコピーして分枝の行を一つ
+// 加えるだけで解ける(最後の子はコピーせずに表をもらう). スレッドごとに
+// MIPOptions::tableaus個までで, 足りなければ一番古いものを捨てる
+template <class T>
+struct MIPCached {
+  MIPTableau<T> t;
+  std::vector<MIPBound<T> > bounds;
+  long id = -1;                 /* 節点の番号, 空きは-1 */
+  int children = 0;             /* まだ解いていない子 */
+  long stamp = 0;               /* 入れた順 */
+};
+
+// 解いた節点の表を調べ, 整数解なら暫定解を更新し, そうでなければ子をpoolに積む
+// (積んだらtrue)
+template <class T>
+static bool branch(MIPSearch<T> &search, const MIPTableau<T> &t, const std::vector<MIPBound<T> > &bounds,
+                   long id, NodePool<T> &pool) {
+  int m = t.All.getRow() - 1;
+  T f = t.All[m][t.All.getCol()-1];
+  if (search.pruned(f)) return false;
+
+  // 最も小数部分が0.5に近い整数変数で分ける
+  Solution<T> sol = getSolution(t.All, t.basis);
+  int n = sol.x.getSize();
+  int var = -1;
+  T best = search.opt.integrality;
+  for (int j = 0; j < n; j++) {
+    if (!search.integer[j]) continue;
+    T frac = sol.x[j] - std::floor(sol.x[j]);
+    T dist = std::min(frac, 1 - frac);
+    if (dist > best) {
+      best = dist;
+      var = j;
+    }
+  }
+
+  if (var == -1) {
+    std::lock_guard<std::mutex> lock(search.incumbentMutex);
+    if (!search.found || f > search.f) {
+      search.x = sol.x;
+      search.f = f;
+      search.found = true;
+      search.incumbent.store((double)f);
+    }
+    return false;
+  }
+
+  // 子の制約は親の制約の同じ変数, 同じ向きのものを置き換える(一番きつい)
+  T v = sol.x[var];
+  MIPNode<T> child[2];
+  for (int k = 0; k < 2; k++) {
+    MIPBound<T> add = {var, k == 0 ? std::floor(v) : std::ceil(v), k == 1};
+    child[k].bounds = bounds;
+    child[k].parent = id;
+    child[k].lpBound = f;
+    bool replaced = false;
+    for (size_t l = 0; l < bounds.size(); l++) {
+      if (bounds[l].var == var && bounds[l].up == add.up) {
+        child[k].bounds[l] = add;
+        replaced = true;
+      }
+    }
+    if (!replaced) child[k].bounds.push_back(add);
+  }
+  // 深さ優先では値に近い側を先に(後に積んだ方が先に取られる)
+  bool upFirst = v - std::floor(v) > 0.5;
+  search.pending += 2;
+  pool.push(std::move(child[upFirst ? 0 : 1]));
+  pool.push(std::move(child[upFirst ? 1 : 0]));
+  search.queued += 2;
+  search.wake();
+  return true;
+}
+
+// 節点の表をtに作って解く. 親の表が手元にあり, 分枝の行が一つ増えただけなら
+// それに一行加え, そうでなければ根の表に全ての分枝の行を加える
+template <class T>
+static SolveStatus solveNode(MIPSearch<T> &search, const MIPNode<T> &node,
+                             std::vector<MIPCached<T> > &cache, MIPTableau<T> &t) {
+  MIPCached<T> *parent = 0;
+  for (size_t k = 0; k < cache.size(); k++) {
+    if (cache[k].id == node.parent && node.bounds.size() == cache[k].bounds.size() + 1) {
+      parent = &cache[k];
+    }
+  }
+  size_t first = 0;
+  if (parent && --parent->children == 0) {
+    // 最後の子: 表をもらう(tの領域は空いた場所に回す)
+    t.All.swap(parent->t.All);
+    t.basis.swap(parent->t.basis);
+    first = parent->bounds.size();
+    parent->id = -1;
+  } else {
+    const MIPTableau<T> &from = parent ? parent->t : search.root;
+    if (parent) first = parent->bounds.size();
+    // tは前の節点の表の領域で, 大きさが同じならそのまま上書きする
+    if (t.All.getRow() != from.All.getRow() || t.All.getCol() != from.All.getCol()) {
+      t.All.setSize(from.All.getRow(), from.All.getCol());
+    }
+    t.All = from.All;
+    t.basis = from.basis;
+  }
+  int n = (int)search.integer.size();
+  int k = (int)(node.bounds.size() - first);
+  BasicMatrix<T> C(k, n);
+  BasicVector<T> d(k);
+  for (int i = 0; i < k; i++) {
+    const MIPBound<T> &bound = node.bounds[first + i];
+    C[i][bound.var] = bound.up ? -1 : 1;
+    d[i] = bound.up ? -bound.bound : bound.bound;
+  }
+  return addRows(t.All, t.basis, C, d, search.opt.lp);
+}
+
+template <class T>
+static void worker(MIPSearch<T> &search, int id, long &count) {
+  int threads = (int)search.pools.size();
+  NodePool<T> &own = *search.pools[id];
+  std::vector<MIPCached<T> > cache(std::max(0, search.opt.tableaus));
+  long stamp = 0;
+  MIPTableau<T> t;
+  while (!search.stop.load()) {
+    MIPNode<T> node;
+    bool got = own.pop(node);
+    for (int k = 1; !got && k < threads; k++) {
+      got = search.pools[(id + k) % threads]->steal(node);
+    }
+    if (!got) {
+      // 積まれるか, 全て終わるか, 止められるまで待つ
+      std::unique_lock<std::mutex> lock(search.idleMutex);
+      search.idle.wait(lock, [&search]() {
+        return search.queued.load() > 0 || search.pending.load() == 0 || search.stop.load();
+      });
+      if (search.pending.load() == 0) break;
+      continue;
+    }
+    search.queued--;
+
+    if (search.opt.maxNodes > 0 && search.solved.load() >= search.opt.maxNodes) {
+      search.stop.store(true);
+    } else if (!search.pruned(node.lpBound)) {
+      long serial = ++search.solved;
+      count++;
+      SolveStatus status = solveNode(search, node, cache, t);
+      if (status == SOLVE_OPTIMAL) {
+        if (branch<T>(search, t, node.bounds, serial, own) && !cache.empty()) {
+          // 子のために表を残す(空きか一番古い場所と入れ替える)
+          size_t victim = 0;
+          for (size_t k = 1; k < cache.size() && cache[victim].id != -1; k++) {
+            if (cache[k].id == -1 || cache[k].stamp < cache[victim].stamp) victim = k;
+          }
+          MIPCached<T> &slot = cache[victim];
+          slot.t.All.swap(t.All);
+          slot.t.basis.swap(t.basis);
+          slot.bounds.swap(node.bounds);
+          slot.id = serial;
+          slot.children = 2;
+          slot.stamp = ++stamp;
+        }
+      } else if (status != SOLVE_INFEASIBLE) {
+        // 予算が尽きたか止められた節点を捨てると最適性が崩れるので探索を止める
+        search.stopStatus.store(status);
+        search.stop.store(true);
+      }
+    }
+    if (--search.pending == 0 || search.stop.load()) search.wake();
+  }
+}
+
+template <class T>
+MIPResult<T> branchAndBound(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                            const std::vector<bool> &integer, const MIPOptions<T> &opt) {
+  int m = b.getSize();
+  int n = c.getSize();
+  if ((int)integer.size() != n) {
+    std::cout << "error: sizes do not match" << "\n";
+    std::abort();
+  }
+  int threads = opt.threads > 0 ? opt.threads : (int)std::thread::hardware_concurrency();
+  if (threads < 1) threads = 1;
+  MIPResult<T> r = {SOLVE_OPTIMAL, BasicVector<T>(n), 0, 1, std::vector<long>(threads, 0)};
+
+  // 根
+  bool nonnegative_b = true;
+  for (int i = 0; i < m; i++) {
+    if (b[i] < 0) nonnegative_b = false;
+  }
+  MIPSearch<T> search(integer, opt);
+  MIPTableau<T> &root = search.root;
+  if (nonnegative_b) {
+    createMatrix(A, b, c, root.basis).swap(root.All);
+  } else {
+    r.status = subProblem(A, b, c, root.All, root.basis, opt.lp);
+    if (r.status != SOLVE_OPTIMAL) return r;
+  }
+  r.status = simplexMethod(root.All, root.basis, opt.lp);
+  if (r.status != SOLVE_OPTIMAL) return r;
+
+  search.x.setSize(n);
+  for (int k = 0; k < threads; k++) {
+    search.pools.emplace_back(new NodePool<T>(opt.selection));
+  }
+  branch<T>(search, root, std::vector<MIPBound<T> >(), 0, *search.pools[0]);
+
+  std::vector<std::thread> pool;
+  for (int k = 1; k < threads; k++) {
+    pool.emplace_back(worker<T>, std::ref(search), k, std::ref(r.threadNodes[k]));
+  }
+  worker(search, 0, r.threadNodes[0]);
+  for (size_t k = 0; k < pool.size(); k++) {
+    pool[k].join();
+  }
+
+  for (int k = 0; k < threads; k++) {
+    r.nodes += r.threadNodes[k];
+  }
+  if (search.found) {
+    r.x = search.x;
+    r.f = search.f;
+  }
+  if (search.stop.load()) r.status = (SolveStatus)search.stopStatus.load();
+  else r.status = search.found ? SOLVE_OPTIMAL : SOLVE_INFEASIBLE;
+  return r;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                          explicit instantiation                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#define INSTANTIATE_MIP(T)                                                     \
+  template MIPResult<T> branchAndBound(const BasicMatrix<T> &, const BasicVector<T> &, \
+                                       const BasicVector<T> &, const std::vector<bool> &, \
+                                       const MIPOptions<T> &);
+
+INSTANTIATE_MIP(float)
+INSTANTIATE_MIP(double)
+INSTANTIATE_MIP(long double)
@@ -0,0 +1,50 @@
+#pragma once
+#include "simplex.hpp"
+#include <vector>
+
+// branch and bound for maximize c^Tx s.t. Ax \leq b, x \geq 0, x_j integer
+// for every j with integer[j]
+//
+// An open node holds no tableau, only its branching rows x_j \leq floor(v) or
+// -x_j \leq -ceil(v) from the root, the tightest one per variable and
+// direction, so its size is bounded by the number of integer variables and
+// not by the depth. Every thread keeps the tableaus of the last
+// MIPOptions::tableaus nodes it branched on: a child of one of them copies it
+// (the second child takes it over) and adds its one new row with addRows; any
+// other node copies the optimal root tableau and adds all of its rows. Either
+// way the node is re-optimized by dual simplex pivots instead of a cold
+// solve. Open nodes live in one pool per thread: a thread takes nodes from its
+// own pool and steals from the others when it runs dry, and sleeps on a
+// condition variable while all pools are empty. The incumbent is shared by
+// all threads (an atomic copy of its value is read for pruning).
+
+enum NodeSelection {
+  MIP_BEST_BOUND,               /* largest LP bound first */
+  MIP_DEPTH_FIRST               /* newest node first, thieves take the oldest */
+};
+
+template <class T>
+struct MIPOptions {
+  NodeSelection selection = MIP_BEST_BOUND;
+  int threads = 0;              /* 0: std::thread::hardware_concurrency() */
+  long maxNodes = 0;            /* 0: no limit */
+  int tableaus = 16;            /* tableaus of solved nodes each thread keeps for their children */
+  T integrality = std::sqrt(ScalarTraits<T>::nearlyZero()); /* |x_j - round(x_j)| below this is integral */
+  SimplexOptions<T> lp;         /* options of every LP solve */
+};
+
+template <class T>
+struct MIPResult {
+  // SOLVE_OPTIMAL, SOLVE_INFEASIBLE (no integer point), SOLVE_UNBOUNDED (LP
+  // relaxation), SOLVE_ITERATION_LIMIT (maxNodes reached, x is the incumbent),
+  // or the status of a node LP stopped by the limits or the token of opt.lp
+  SolveStatus status;
+  BasicVector<T> x;             /* incumbent, n */
+  T f;                          /* c^Tx of the incumbent */
+  long nodes;                   /* LP solves including the root */
+  std::vector<long> threadNodes; /* nodes solved by each thread */
+};
+
+template <class T>
+MIPResult<T> branchAndBound(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                            const std::vector<bool> &integer, const MIPOptions<T> &opt = MIPOptions<T>());
@@ -0,0 +1,379 @@
+#include "mixed_precision.hpp"
+#include "budget.hpp"
+#include <algorithm>
+#include <chrono>
+#if defined(__SSE2__)
+#include <xmmintrin.h>
+#endif
+
+using std::cout;
+using std::endl;
+
+typedef float Low;
+typedef std::chrono::steady_clock Clock;
+
+static double microseconds(Clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+// 掃き出しで生じる非正規化数(floatで~1E-38未満)は演算を何倍も遅くするので,
+// floatで解く間だけ0に丸める(SSEのMXCSRのFTZとDAZ). 許容誤差よりずっと小さい
+class FlushDenormals {
+ public:
+#if defined(__SSE2__)
+  FlushDenormals() : saved(_mm_getcsr()) { _mm_setcsr(saved | 0x8040); }
+  ~FlushDenormals() { _mm_setcsr(saved); }
+
+ private:
+  unsigned saved;
+#endif
+};
+
+// 表 [A I b/beta; -c/gamma 0 0] をfloatで直接作る(Aのfloatの写しを作らない)
+template <class T>
+static void lowTableau(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                       T beta, T gamma, BasicMatrix<Low> &All, Basis &basis) {
+  int m = b.getSize();
+  int n = c.getSize();
+  All.setSize(m+1, n+m+1);
+  basis.resize(m);
+  for (int i = 0; i < m; i++) {
+    Low *r = &All[i][0];
+    const T *a = &A[i][0];
+    for (int j = 0; j < n; j++) {
+      r[j] = (Low)a[j];
+    }
+    r[n+i] = 1;
+    r[n+m] = (Low)(b[i] / beta);
+    basis[i] = n+i;
+  }
+  for (int j = 0; j < n; j++) {
+    All[m][j] = -(Low)(c[j] / gamma);
+  }
+}
+
+// 解の残差 max_i |b_i - A_ix - s_i|, max_j |A_j^Ty - c_j - d_j| (相対).
+// 0でないx_j, y_iの列, 行だけを見るのでO(m|x| + n|y|)
+template <class T>
+static void residuals(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                      MixedResult<T> &res) {
+  int m = b.getSize();
+  int n = c.getSize();
+  const Solution<T> &sol = res.solution;
+  T bmax = 0, cmax = 0;
+  for (int i = 0; i < m; i++) bmax = std::max(bmax, (T)std::fabs(b[i]));
+  for (int j = 0; j < n; j++) cmax = std::max(cmax, (T)std::fabs(c[j]));
+  std::vector<int> support;
+  for (int j = 0; j < n; j++) {
+    if (sol.x[j] != 0) support.push_back(j);
+  }
+  T primal = 0;
+  for (int i = 0; i < m; i++) {
+    T r = b[i] - sol.slack[i];
+    for (size_t q = 0; q < support.size(); q++) {
+      r -= A[i][support[q]] * sol.x[support[q]];
+    }
+    primal = std::max(primal, (T)std::fabs(r));
+  }
+  BasicVector<T> d(n);
+  for (int j = 0; j < n; j++) {
+    d[j] = -c[j] - sol.reducedCost[j];
+  }
+  for (int i = 0; i < m; i++) {
+    T y = sol.dual[i];
+    if (y == 0) continue;
+    const T *a = &A[i][0];
+    for (int j = 0; j < n; j++) {
+      d[j] += a[j] * y;
+    }
+  }
+  T dual = 0;
+  for (int j = 0; j < n; j++) {
+    dual = std::max(dual, (T)std::fabs(d[j]));
+  }
+  res.primalResidual = primal / (1 + bmax);
+  res.dualResidual = dual / (1 + cmax);
+}
+
+// 基底lowの核 A_RS (Sは基底にある構造変数の列, Rはスラック変数が基底にない行)を
+// Tで分解して x_S = A_RS^{-1}b_R, y_R = A_RS^{-T}c_S を求め, 元の問題での残差で
+// 反復改良し, 解をres.solutionに書く. primal, dualは主, 双対実行可能か
+// (核が正方でないか特異なら両方false)
+template <class T>
+static void refine(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                   const Basis &low, int refinements, MixedResult<T> &res, bool &primal, bool &dual) {
+  int m = b.getSize();
+  int n = c.getSize();
+  primal = dual = false;
+  std::vector<int> S, R;
+  std::vector<bool> slackBasic(m, false);
+  for (int i = 0; i < m; i++) {
+    int j = low[i];
+    if (j < 0) return;
+    if (j < n) S.push_back(j);
+    else slackBasic[j-n] = true;
+  }
+  for (int i = 0; i < m; i++) {
+    if (!slackBasic[i]) R.push_back(i);
+  }
+  int k = (int)S.size();
+  if ((int)R.size() != k) return;
+
+  BasicMatrix<T> K(k, k);
+  for (int p = 0; p < k; p++) {
+    for (int q = 0; q < k; q++) {
+      K[p][q] = A[R[p]][S[q]];
+    }
+  }
+  BasicMatrix<T> F = K;
+  std::vector<int> perm;
+  if (k > 0 && !lu(F, perm)) return;
+  BasicVector<T> xs(k), ys(k);
+  for (int p = 0; p < k; p++) {
+    xs[p] = b[R[p]];
+    ys[p] = c[S[p]];
+  }
+  if (k > 0) {
+    luSolve(F, perm, xs);
+    luSolveTransposed(F, perm, ys);
+  }
+  const T eps = std::numeric_limits<T>::epsilon();
+  for (int step = 0; step < refinements && k > 0; step++) {
+    BasicVector<T> rx(k), ry(k);
+    for (int p = 0; p < k; p++) {
+      T sum = b[R[p]];
+      for (int q = 0; q < k; q++) {
+        sum -= K[p][q] * xs[q];
+      }
+      rx[p] = sum;
+    }
+    for (int q = 0; q < k; q++) {
+      T sum = c[S[q]];
+      for (int p = 0; p < k; p++) {
+        sum -= K[p][q] * ys[p];
+      }
+      ry[q] = sum;
+    }
+    luSolve(F, perm, rx);
+    luSolveTransposed(F, perm, ry);
+    T dx = 0, dy = 0, nx = 0, ny = 0;
+    for (int p = 0; p < k; p++) {
+      xs[p] += rx[p];
+      ys[p] += ry[p];
+      dx = std::max(dx, (T)std::fabs(rx[p]));
+      dy = std::max(dy, (T)std::fabs(ry[p]));
+      nx = std::max(nx, (T)std::fabs(xs[p]));
+      ny = std::max(ny, (T)std::fabs(ys[p]));
+    }
+    res.refinements++;
+    if (dx <= eps * nx && dy <= eps * ny) break;
+  }
+
+  // x, y から残りを出す. 基底にある列の被約費用, 基底にないスラック変数は0
+  Solution<T> &sol = res.solution;
+  for (int q = 0; q < k; q++) {
+    sol.x[S[q]] = xs[q];
+  }
+  for (int p = 0; p < k; p++) {
+    sol.dual[R[p]] = ys[p];
+  }
+  for (int i = 0; i < m; i++) {
+    if (!slackBasic[i]) continue;
+    T s = b[i];
+    for (int q = 0; q < k; q++) {
+      s -= A[i][S[q]] * xs[q];
+    }
+    sol.slack[i] = s;
+  }
+  for (int j = 0; j < n; j++) {
+    sol.reducedCost[j] = -c[j];
+  }
+  for (int p = 0; p < k; p++) {
+    const T *a = &A[R[p]][0];
+    T y = ys[p];
+    for (int j = 0; j < n; j++) {
+      sol.reducedCost[j] += a[j] * y;
+    }
+  }
+  for (int q = 0; q < k; q++) {
+    sol.reducedCost[S[q]] = 0;
+  }
+  sol.f = 0;
+  for (int q = 0; q < k; q++) {
+    sol.f += c[S[q]] * xs[q];
+  }
+
+  T bmax = 0, cmax = 0;
+  for (int i = 0; i < m; i++) bmax = std::max(bmax, (T)std::fabs(b[i]));
+  for (int j = 0; j < n; j++) cmax = std::max(cmax, (T)std::fabs(c[j]));
+  const T primalTol = ScalarTraits<T>::nearlyZero() * (1 + bmax);
+  const T dualTol = ScalarTraits<T>::nearlyZero() * (1 + cmax);
+  primal = dual = true;
+  for (int q = 0; q < k; q++) {
+    if (xs[q] < -primalTol) primal = false;
+    if (ys[q] < -dualTol) dual = false;
+  }
+  for (int i = 0; i < m; i++) {
+    if (sol.slack[i] < -primalTol) primal = false;
+  }
+  for (int j = 0; j < n; j++) {
+    if (sol.reducedCost[j] < -dualTol) dual = false;
+  }
+}
+
+// Tの表で解く. lowが0でなければ, その基底を入れてから単体法を続ける.
+// 予算はstartから(floatのピボットも含めて)数えた残りだけ使う
+template <class T>
+static SolveStatus highSolve(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                             const Basis *low, const SimplexOptions<T> &opt, Clock::time_point start,
+                             MixedResult<T> &res) {
+  int m = b.getSize();
+  int n = c.getSize();
+  bool nonnegative_b = true;
+  for (int i = 0; i < m; i++) {
+    if (b[i] < 0) nonnegative_b = false;
+  }
+  SimplexResult<T> &r = res.result;
+  long before = r.stats.iterations;
+  SimplexOptions<T> rest;
+  SolveStatus status = remainingBudget(opt, r.stats.iterations, start, rest);
+  if (status != SOLVE_OPTIMAL) return status;
+  Basis basis;
+  BasicMatrix<T> All;
+  if (low || nonnegative_b) {
+    createMatrix(A, b, c, basis).swap(All);
+    if (low) {
+      int structural = 0;
+      for (int i = 0; i < m; i++) {
+        if ((*low)[i] >= 0 && (*low)[i] < n) structural++;
+      }
+      res.highIterations += structural - installBasis(All, basis, *low);
+    }
+    status = simplexMethod(All, basis, rest, &r);
+  } else {
+    status = subProblem(A, b, c, All, basis, rest, &r);
+    if (status == SOLVE_OPTIMAL) status = remainingBudget(opt, r.stats.iterations, start, rest);
+    if (status == SOLVE_OPTIMAL) status = simplexMethod(All, basis, rest, &r);
+  }
+  res.highIterations += r.stats.iterations - before;
+  if (status == SOLVE_OPTIMAL) res.solution = getSolution(All, basis);
+  return status;
+}
+
+template <class T>
+MixedResult<T> mixedPrecisionSolve(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                                   const SimplexOptions<T> &opt, int refinements) {
+  int m = b.getSize();
+  int n = c.getSize();
+  if (A.getRow() != m || (m > 0 && A.getCol() != n)) {
+    cout << "error: sizes do not match" << "\n";
+    abort();
+  }
+  MixedResult<T> res = {SOLVE_OPTIMAL, MIXED_REFINED, 0, 0, 0, 0, 0, 0, 0,
+                        {BasicVector<T>(n), BasicVector<T>(m), BasicVector<T>(m), BasicVector<T>(n), 0},
+                        SimplexResult<T>()};
+  Clock::time_point start = Clock::now();
+
+  // cleanupは表全体の最大値に対する相対誤差(floatでは~6.5E-6)で0にするので,
+  // b, cを最大値1に揃えてから表を作る. 最適な基底は変わらない
+  T beta = 0, gamma = 0;
+  for (int i = 0; i < m; i++) beta = std::max(beta, (T)std::fabs(b[i]));
+  for (int j = 0; j < n; j++) gamma = std::max(gamma, (T)std::fabs(c[j]));
+  if (beta == 0) beta = 1;
+  if (gamma == 0) gamma = 1;
+
+  SimplexOptions<Low> lo;
+  lo.stallLimit = opt.stallLimit;
+  lo.seed = opt.seed;
+  lo.pricing = opt.pricing;
+  // floatの被約費用の誤差(~1E-4)を追いかけないよう粗く打ち切る. 残りはrefineで見る
+  lo.optimality = std::pow(std::numeric_limits<Low>::epsilon(), Low(0.375));
+  // floatの誤差で退化したピボットが続くと終わらないので 2(m+n) 回で打ち切る
+  const long lowLimit = 2L * (m + n) + 10;
+  lo.maxIterations = (opt.maxIterations > 0 && opt.maxIterations < lowLimit) ? opt.maxIterations : lowLimit;
+  lo.timeLimit = opt.timeLimit;
+  lo.cancel = opt.cancel;
+  lo.checkEvery = opt.checkEvery;
+  if (opt.progress) {
+    const std::function<void(const SimplexProgress<T> &)> &progress = opt.progress;
+    lo.progress = [&progress, beta, gamma](const SimplexProgress<Low> &p) {
+      SimplexProgress<T> q = {p.iterations, p.objective * beta * gamma, p.infeasibility * beta, p.elapsed};
+      progress(q);
+    };
+  }
+  bool nonnegative_b = true;
+  for (int i = 0; i < m; i++) {
+    if (b[i] < 0) nonnegative_b = false;
+  }
+
+  // floatの表でピボットし, 基底だけを残す
+  Basis low;
+  SimplexResult<Low> lr;
+  SolveStatus status;
+  {
+    FlushDenormals flush;
+    BasicMatrix<Low> LowAll;
+    if (nonnegative_b) {
+      lowTableau(A, b, c, beta, gamma, LowAll, low);
+      status = simplexMethod(LowAll, low, lo, &lr);
+    } else {
+      {
+        BasicMatrix<Low> Af(m, n);
+        BasicVector<Low> bf(m), cf(n);
+        for (int i = 0; i < m; i++) {
+          for (int j = 0; j < n; j++) {
+            Af[i][j] = (Low)A[i][j];
+          }
+          bf[i] = (Low)(b[i] / beta);
+        }
+        for (int j = 0; j < n; j++) {
+          cf[j] = (Low)(c[j] / gamma);
+        }
+        status = subProblem(Af, bf, cf, LowAll, low, lo, &lr);
+      }
+      SimplexOptions<Low> rest;
+      if (status == SOLVE_OPTIMAL) status = remainingBudget(lo, lr.stats.iterations, start, rest);
+      if (status == SOLVE_OPTIMAL) status = simplexMethod(LowAll, low, rest, &lr);
+    }
+  }
+  res.lowIterations = lr.stats.iterations;
+  res.result.stats = lr.stats;
+  res.lowTime = microseconds(start);
+  if (status == SOLVE_CANCELLED || status == SOLVE_TIME_LIMIT) {
+    res.status = status;
+    res.result.status = status;
+    return res;
+  }
+
+  // 最適な基底はTで分解し直して改良する. 主か双対の一方が実行可能なら
+  // その基底からTのピボットで続ける(負の右辺は双対単体法が片付ける).
+  // 両方だめな基底, floatの非有界, 実行不可能, 打ち切り(SOLVE_ITERATION_LIMIT)は
+  // 最適から遠いのでTで初めから解き直す. optの回数を使い切っていればそこで止まる
+  Clock::time_point high = Clock::now();
+  bool primal = false, dual = false;
+  if (status == SOLVE_OPTIMAL) refine(A, b, c, low, refinements, res, primal, dual);
+  if (primal && dual) {
+    res.status = SOLVE_OPTIMAL;
+  } else if (primal || dual) {
+    res.path = MIXED_WARM;
+    res.status = highSolve(A, b, c, &low, opt, start, res);
+  } else {
+    res.path = MIXED_COLD;
+    res.status = highSolve(A, b, c, (const Basis *)0, opt, start, res);
+  }
+  res.result.status = res.status;
+  if (res.status == SOLVE_OPTIMAL) residuals(A, b, c, res);
+  res.highTime = microseconds(high);
+  return res;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                          explicit instantiation                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#define INSTANTIATE_MIXED_PRECISION(T)                                         \
+  template MixedResult<T> mixedPrecisionSolve(const BasicMatrix<T> &, const BasicVector<T> &, \
+                                              const BasicVector<T> &, const SimplexOptions<T> &, int);
+
+INSTANTIATE_MIXED_PRECISION(double)
+INSTANTIATE_MIXED_PRECISION(long double)
@@ -0,0 +1,63 @@
+#pragma once
+#include "simplex.hpp"
+
+// mixed-precision solve of maximize c^Tx s.t. Ax \leq b, x \geq 0
+//
+// Every pivot streams the whole tableau through memory, so the pivots run on
+// a float tableau (half the bytes of double) and only its final basis is
+// kept. With the structural columns S and the slacks of the rows K basic,
+// B = [A_S e_K] reduces to the k x k kernel A_RS, R being the rows whose
+// slack is nonbasic (k = |S| \leq min(m, n)). The kernel is factorized in T
+// (lu), x_S = A_RS^{-1} b_R and y_R = A_RS^{-T} c_S are refined with
+// residuals taken against the original (A, b, c), and the slacks, the
+// objective and the reduced costs follow in O((m+n)k). The refined point is
+// accepted if it is primal and dual feasible to ScalarTraits<T>::nearlyZero()
+// relative to max|b| and max|c|. If it is only one of the two, the float
+// basis is installed in a T tableau (installBasis) and the T simplex method
+// finishes from there (the dual simplex cleanup handles negative basic
+// values); a basis that is neither is solved again in T from scratch.
+//
+// The float tableau is built from b / max|b| and c / max|c|, which leaves the
+// optimal basis alone but keeps Matrix::cleanup (relative to the largest
+// entry) from zeroing real entries at float tolerances; on SSE denormals are
+// flushed to zero while it pivots. It stops at reduced costs above
+// -eps_float^(3/8) (~2.6E-3 of max|c|) rather than chase its own rounding
+// noise. Those errors still grow with the number of pivots: on square
+// problems of a few hundred rows float steps fall below its zero tolerance
+// and the solve degenerates into Bland's rule, or ends on an unbounded or
+// infeasible verdict far from the optimum. The float solve is therefore cut
+// off after 2(m+n)+10 pivots, and a cut-off or a float verdict other than
+// optimal is solved again in T from scratch.
+
+enum MixedPath {
+  MIXED_REFINED,                /* the float basis was optimal; solution from the refined kernel */
+  MIXED_WARM,                   /* T pivots from the float basis, which was primal or dual feasible */
+  MIXED_COLD                    /* solved again in T from scratch */
+};
+
+template <class T>
+struct MixedResult {
+  SolveStatus status;
+  MixedPath path;
+  long lowIterations;           /* pivots on the float tableau */
+  long highIterations;          /* pivots in T (installing the basis and the fallback) */
+  int refinements;              /* refinement steps taken (each corrects x and y) */
+  T primalResidual;             /* max_i |b_i - A_ix - s_i| / (1 + max|b|) of the solution */
+  T dualResidual;               /* max_j |A_j^Ty - c_j - d_j| / (1 + max|c|) of the solution */
+  double lowTime;               /* [μs] of the float solve, including building its tableau */
+  double highTime;              /* [μs] of the refinement and of any fallback */
+  Solution<T> solution;         /* SOLVE_OPTIMAL */
+  SimplexResult<T> result;      /* certificate from T pivots; stats of the float and the T pivots */
+};
+
+// opt applies to the float solve (its pricing, limits, token and a progress
+// converted to T) and to the T fallback. maxIterations and timeLimit bound the
+// whole call: the fallback gets what the float pivots left of them, and
+// returns SOLVE_ITERATION_LIMIT or SOLVE_TIME_LIMIT at once if nothing is
+// left. If the time limit or the token stops the float solve its status is
+// returned and nothing is solved in T.
+// Instantiated for double and long double; float pivots on T = float are
+// just simplexMethod
+template <class T>
+MixedResult<T> mixedPrecisionSolve(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                                   const SimplexOptions<T> &opt = SimplexOptions<T>(), int refinements = 3);
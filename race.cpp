@@ -0,0 +1,329 @@
+#include "race.hpp"
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+std::string strategyName(const Strategy &strategy) {
+  std::string name = strategy.dual ? "dual" : "primal";
+  if (strategy.pricing == PRICING_DANTZIG) name += " dantzig";
+  else if (strategy.pricing == PRICING_STEEPEST_EDGE) name += " steepest edge";
+  else name += " bland";
+  if (strategy.scaled) name += " scaled";
+  return name;
+}
+
+std::vector<Strategy> defaultStrategies() {
+  std::vector<Strategy> strategies;
+  strategies.push_back({PRICING_DANTZIG, false, false});
+  strategies.push_back({PRICING_STEEPEST_EDGE, false, false});
+  strategies.push_back({PRICING_DANTZIG, true, false});
+  strategies.push_back({PRICING_STEEPEST_EDGE, true, false});
+  strategies.push_back({PRICING_DANTZIG, false, true});
+  return strategies;
+}
+
+// 一つの戦略で解き, 解と証明を元の問題 (A, b, c) の言葉に戻す
+template <class T>
+static RaceResult<T> solveStrategy(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                                   const Strategy &strategy, const SimplexOptions<T> &opt) {
+  int m = b.getSize();
+  int n = c.getSize();
+
+  // 行を max_j |a_ij| で, 次に列を max_i |a_ij| で割る. x = S x', y = R y'
+  BasicVector<T> R(m), S(n);
+  for (int i = 0; i < m; i++) R[i] = 1;
+  for (int j = 0; j < n; j++) S[j] = 1;
+  BasicMatrix<T> As = A;
+  if (strategy.scaled) {
+    for (int i = 0; i < m; i++) {
+      T big = 0;
+      for (int j = 0; j < n; j++) big = std::max(big, (T)std::fabs(As[i][j]));
+      if (big > 0) R[i] = 1 / big;
+      for (int j = 0; j < n; j++) As[i][j] *= R[i];
+    }
+    BasicVector<T> big(n);
+    for (int i = 0; i < m; i++) {
+      for (int j = 0; j < n; j++) big[j] = std::max(big[j], (T)std::fabs(As[i][j]));
+    }
+    for (int j = 0; j < n; j++) {
+      if (big[j] > 0) S[j] = 1 / big[j];
+    }
+    for (int i = 0; i < m; i++) {
+      for (int j = 0; j < n; j++) As[i][j] *= S[j];
+    }
+  }
+
+  // 双対問題は max -b'^Ty s.t. -A'^Ty \leq -c', y \geq 0
+  int rows = strategy.dual ? n : m;
+  int cols = strategy.dual ? m : n;
+  BasicMatrix<T> P(rows, cols);
+  BasicVector<T> q(rows), d(cols);
+  for (int i = 0; i < m; i++) {
+    for (int j = 0; j < n; j++) {
+      if (strategy.dual) P[j][i] = -As[i][j];
+      else P[i][j] = As[i][j];
+    }
+  }
+  for (int i = 0; i < m; i++) {
+    if (strategy.dual) d[i] = -b[i] * R[i];
+    else q[i] = b[i] * R[i];
+  }
+  for (int j = 0; j < n; j++) {
+    if (strategy.dual) q[j] = -c[j] * S[j];
+    else d[j] = c[j] * S[j];
+  }
+
+  bool nonnegative_q = true;
+  for (int i = 0; i < rows; i++) {
+    if (q[i] < 0) nonnegative_q = false;
+  }
+  Basis basis;
+  BasicMatrix<T> All;
+  SimplexResult<T> r;
+  SolveStatus status;
+  if (nonnegative_q) {
+    createMatrix(P, q, d, basis).swap(All);
+    status = simplexMethod(All, basis, opt, &r);
+  } else {
+    status = subProblem(P, q, d, All, basis, opt, &r);
+    if (status == SOLVE_OPTIMAL) status = simplexMethod(All, basis, opt, &r);
+  }
+
+  RaceResult<T> res = {status, -1, false,
+                       {BasicVector<T>(n), BasicVector<T>(m), BasicVector<T>(m), BasicVector<T>(n), 0},
+                       SimplexResult<T>(), 0};
+  res.result.stats = r.stats;
+  Solution<T> &sol = res.solution;
+  if (!strategy.dual) {
+    if (status == SOLVE_OPTIMAL) {
+      Solution<T> s = getSolution(All, basis);
+      for (int j = 0; j < n; j++) sol.x[j] = s.x[j];
+      for (int i = 0; i < m; i++) sol.slack[i] = s.slack[i];
+      for (int i = 0; i < m; i++) sol.dual[i] = s.dual[i];
+      for (int j = 0; j < n; j++) sol.reducedCost[j] = s.reducedCost[j];
+      sol.f = s.f;
+    } else if (status == SOLVE_UNBOUNDED) {
+      res.result.ray.setSize(n);
+      for (int j = 0; j < n; j++) res.result.ray[j] = r.ray[j];
+    } else if (status == SOLVE_INFEASIBLE) {
+      res.result.farkas.setSize(m);
+      for (int i = 0; i < m; i++) res.result.farkas[i] = r.farkas[i];
+    }
+  } else {
+    // 双対問題の表では x' が双対価格, A'x' \leq b' のスラックが被約費用.
+    // 双対問題の非有界な方向は主問題のファルカスの証明, ファルカスの証明は非有界な方向
+    if (status == SOLVE_OPTIMAL) {
+      Solution<T> s = getSolution(All, basis);
+      for (int j = 0; j < n; j++) sol.x[j] = s.dual[j];
+      for (int i = 0; i < m; i++) sol.slack[i] = s.reducedCost[i];
+      for (int i = 0; i < m; i++) sol.dual[i] = s.x[i];
+      for (int j = 0; j < n; j++) sol.reducedCost[j] = s.slack[j];
+      sol.f = -s.f;
+    } else if (status == SOLVE_UNBOUNDED) {
+      res.status = SOLVE_INFEASIBLE;
+      res.result.farkas.setSize(m);
+      for (int i = 0; i < m; i++) res.result.farkas[i] = r.ray[i];
+    } else if (status == SOLVE_INFEASIBLE) {
+      res.status = SOLVE_UNBOUNDED;
+      res.result.ray.setSize(n);
+      for (int j = 0; j < n; j++) res.result.ray[j] = r.farkas[j];
+    }
+  }
+  res.result.status = res.status;
+
+  for (int j = 0; j < n; j++) {
+    sol.x[j] *= S[j];
+    sol.reducedCost[j] /= S[j];
+  }
+  for (int i = 0; i < m; i++) {
+    sol.slack[i] /= R[i];
+    sol.dual[i] *= R[i];
+  }
+  for (int j = 0; j < res.result.ray.getSize(); j++) res.result.ray[j] *= S[j];
+  for (int i = 0; i < res.result.farkas.getSize(); i++) res.result.farkas[i] *= R[i];
+  return res;
+}
+
+// 解(あるいは証明)が元の問題で成り立つかを相対誤差で確かめる. O(mn)
+template <class T>
+static bool verify(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                   const RaceResult<T> &res) {
+  int m = b.getSize();
+  int n = c.getSize();
+  const T tol = std::sqrt(ScalarTraits<T>::nearlyZero());
+  if (res.status == SOLVE_OPTIMAL) {
+    // Ax \leq b, A^Ty \geq c, x, y \geq 0 と c^Tx = b^Ty
+    const Solution<T> &s = res.solution;
+    T xmax = 0, ymax = 0;
+    for (int j = 0; j < n; j++) xmax = std::max(xmax, (T)std::fabs(s.x[j]));
+    for (int i = 0; i < m; i++) ymax = std::max(ymax, (T)std::fabs(s.dual[i]));
+    for (int j = 0; j < n; j++) {
+      if (s.x[j] < -tol * xmax) return false;
+    }
+    for (int i = 0; i < m; i++) {
+      if (s.dual[i] < -tol * ymax) return false;
+    }
+    BasicVector<T> aty(n), size(n);
+    T cx = 0, by = 0, gapScale = 0;
+    for (int i = 0; i < m; i++) {
+      const T *a = &A[i][0];
+      T ax = 0, axSize = std::fabs(b[i]);
+      for (int j = 0; j < n; j++) {
+        ax += a[j] * s.x[j];
+        axSize += std::fabs(a[j] * s.x[j]);
+        aty[j] += a[j] * s.dual[i];
+        size[j] += std::fabs(a[j] * s.dual[i]);
+      }
+      if (ax - b[i] > tol * axSize) return false;
+      by += b[i] * s.dual[i];
+      gapScale += std::fabs(b[i] * s.dual[i]);
+    }
+    for (int j = 0; j < n; j++) {
+      if (c[j] - aty[j] > tol * (size[j] + std::fabs(c[j]))) return false;
+      cx += c[j] * s.x[j];
+      gapScale += std::fabs(c[j] * s.x[j]);
+    }
+    return std::fabs(cx - by) <= tol * gapScale;
+  }
+  if (res.status == SOLVE_UNBOUNDED) {
+    // d \geq 0, Ad \leq 0, c^Td > 0
+    const BasicVector<T> &d = res.result.ray;
+    T dmax = 0, cd = 0;
+    for (int j = 0; j < n; j++) dmax = std::max(dmax, (T)std::fabs(d[j]));
+    for (int j = 0; j < n; j++) {
+      if (d[j] < -tol * dmax) return false;
+      cd += c[j] * d[j];
+    }
+    for (int i = 0; i < m; i++) {
+      T ad = 0, adSize = 0;
+      for (int j = 0; j < n; j++) {
+        ad += A[i][j] * d[j];
+        adSize += std::fabs(A[i][j] * d[j]);
+      }
+      if (ad > tol * adSize) return false;
+    }
+    return cd > 0;
+  }
+  if (res.status == SOLVE_INFEASIBLE) {
+    // y \geq 0, y^TA \geq 0, y^Tb < 0
+    const BasicVector<T> &y = res.result.farkas;
+    T ymax = 0, yb = 0;
+    for (int i = 0; i < m; i++) ymax = std::max(ymax, (T)std::fabs(y[i]));
+    BasicVector<T> yta(n), size(n);
+    for (int i = 0; i < m; i++) {
+      if (y[i] < -tol * ymax) return false;
+      yb += y[i] * b[i];
+      for (int j = 0; j < n; j++) {
+        yta[j] += y[i] * A[i][j];
+        size[j] += std::fabs(y[i] * A[i][j]);
+      }
+    }
+    for (int j = 0; j < n; j++) {
+      if (yta[j] < -tol * size[j]) return false;
+    }
+    return yb < 0;
+  }
+  return false;
+}
+
+// 確かめられなかった答えは失敗として返す(中身は調べるために残す)
+template <class T>
+static RaceResult<T> unverified(RaceResult<T> res) {
+  res.status = SOLVE_NUMERICAL;
+  res.result.status = SOLVE_NUMERICAL;
+  return res;
+}
+
+template <class T>
+RaceResult<T> raceStrategies(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                             const std::vector<Strategy> &strategies, const SimplexOptions<T> &opt,
+                             RaceStats *stats) {
+  int k = (int)strategies.size();
+  CancelToken stop(opt.cancel);
+  std::mutex mutex;
+  int winner = -1;
+  int first = -1;               /* 確かめられなかった最初の答え(調べるためだけに残す) */
+  int limited = -1;             /* 予算の尽きた最初の戦略 */
+  std::vector<std::unique_ptr<RaceResult<T> > > results(k);
+  auto start = std::chrono::high_resolution_clock::now();
+
+  // 確かめられた答えを最初に出した戦略が勝ち, 残りを止める
+  auto run = [&](int s) {
+    SimplexOptions<T> o = opt;
+    o.pricing = strategies[s].pricing;
+    o.cancel = &stop;
+    RaceResult<T> res = solveStrategy(A, b, c, strategies[s], o);
+    if (res.status == SOLVE_CANCELLED) return;
+    if (strategies[s].dual && res.status == SOLVE_UNBOUNDED) return;
+    res.verified = verify(A, b, c, res);
+    auto end = std::chrono::high_resolution_clock::now();
+    res.winner = s;
+    res.time = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (winner != -1) return;
+    if (res.status == SOLVE_ITERATION_LIMIT || res.status == SOLVE_TIME_LIMIT) {
+      if (limited != -1) return;
+      limited = s;
+    } else if (res.verified) {
+      winner = s;
+      stop.cancel();
+    } else if (first == -1) {
+      first = s;
+    } else {
+      return;
+    }
+    results[s].reset(new RaceResult<T>(res));
+  };
+  std::vector<std::thread> threads;
+  for (int s = 1; s < k; s++) {
+    threads.emplace_back(run, s);
+  }
+  if (k > 0) run(0);
+  for (size_t t = 0; t < threads.size(); t++) {
+    threads[t].join();
+  }
+
+  if (stats) {
+    stats->races++;
+    if ((int)stats->wins.size() < k) stats->wins.resize(k, 0);
+    if (winner != -1) stats->wins[winner]++;
+  }
+  if (winner != -1) return *results[winner];
+  if (limited != -1) return *results[limited];
+  if (first != -1) return unverified(*results[first]);
+
+  // 誰も勝たなかった: 全体が止められたか, 双対問題の戦略しかなく非有界か実行不可能か分からない
+  if (opt.cancel && opt.cancel->cancelled()) {
+    int m = b.getSize();
+    int n = c.getSize();
+    RaceResult<T> res = {SOLVE_CANCELLED, -1, false,
+                         {BasicVector<T>(n), BasicVector<T>(m), BasicVector<T>(m), BasicVector<T>(n), 0},
+                         SimplexResult<T>(), 0};
+    res.result.status = SOLVE_CANCELLED;
+    return res;
+  }
+  Strategy primal = {opt.pricing, false, false};
+  RaceResult<T> res = solveStrategy(A, b, c, primal, opt);
+  res.verified = verify(A, b, c, res);
+  auto end = std::chrono::high_resolution_clock::now();
+  res.time = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+  if (!res.verified && (res.status == SOLVE_OPTIMAL || res.status == SOLVE_UNBOUNDED ||
+                        res.status == SOLVE_INFEASIBLE)) {
+    return unverified(res);
+  }
+  return res;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                          explicit instantiation                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#define INSTANTIATE_RACE(T)                                                    \
+  template RaceResult<T> raceStrategies(const BasicMatrix<T> &, const BasicVector<T> &, \
+                                        const BasicVector<T> &, const std::vector<Strategy> &, \
+                                        const SimplexOptions<T> &, RaceStats *);
+
+INSTANTIATE_RACE(float)
+INSTANTIATE_RACE(double)
+INSTANTIATE_RACE(long double)
@@ -0,0 +1,61 @@
+#pragma once
+#include "simplex.hpp"
+#include <string>
+#include <vector>
+
+// racing of solver strategies for maximize c^Tx s.t. Ax \leq b, x \geq 0
+//
+// Each strategy solves its own copy of the problem on its own thread. The
+// first one to reach a definite answer that passes a residual check against
+// the original (A, b, c) wins, its solution is returned and the others are
+// stopped through a shared CancelToken. The check is O(mn) and keeps a badly
+// scaled run that ended on a wrong "optimal" basis from winning. A strategy is
+// a pricing rule, the formulation and whether rows and columns are scaled:
+//
+//   primal  the tableau of (A, b, c), via subProblem if b has a negative entry
+//   dual    the tableau of the dual max -b^Ty s.t. -A^Ty \leq -c, y \geq 0;
+//           x is read from its duals. An infeasible dual only means that the
+//           primal is unbounded or infeasible, so that answer never wins
+//   scaled  row i divided by max_j |a_ij|, then column j by max_i |a_ij|;
+//           the solution is scaled back before it is returned
+
+struct Strategy {
+  PricingRule pricing;
+  bool dual;
+  bool scaled;
+};
+
+std::string strategyName(const Strategy &strategy);
+
+// primal/dual x Dantzig/steepest edge, and primal Dantzig with scaling
+std::vector<Strategy> defaultStrategies();
+
+// wins of each strategy over calls of raceStrategies (added to, not reset)
+struct RaceStats {
+  int races = 0;
+  std::vector<int> wins;        /* one per strategy */
+};
+
+template <class T>
+struct RaceResult {
+  // SOLVE_CANCELLED only if opt.cancel was cancelled; SOLVE_NUMERICAL if no
+  // answer passed the residual check (solution and result are then those of
+  // the first one, for inspection only)
+  SolveStatus status;
+  int winner;                   /* index into strategies of the answer, -1 for a fallback primal solve */
+  bool verified;                /* passed the residual check; always true for a definite status */
+  Solution<T> solution;         /* SOLVE_OPTIMAL, in terms of the original (A, b, c) */
+  SimplexResult<T> result;      /* statistics and certificate of the winner */
+  double time;                  /* [μs] until the winner finished */
+};
+
+// opt.cancel, if set, stops the whole race. opt.pricing is replaced by the
+// pricing rule of each strategy; the other limits of opt apply to each
+// strategy. An unverified answer is never returned as such: if no answer
+// passed the check and some strategy ran out of its budget, that strategy's
+// status (SOLVE_ITERATION_LIMIT or SOLVE_TIME_LIMIT) is returned, otherwise
+// SOLVE_NUMERICAL
+template <class T>
+RaceResult<T> raceStrategies(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                             const std::vector<Strategy> &strategies,
+                             const SimplexOptions<T> &opt = SimplexOptions<T>(), RaceStats *stats = 0);
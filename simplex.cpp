@@ -0,0 +1,908 @@
+#include "simplex.hpp"
+#include "budget.hpp"
+#include <algorithm>
+#include <vector>
+#include <random>
+
+using std::cout;
+using std::endl;
+
+// 以下の行, 列をピボットにして掃き出しを行う(目的関数の行も含めてAllの全行)
+// (行はSIMDレジスタ一つ分ずつ掃き出す. 表が大きいとメモリの帯域で決まる)
+template <class T>
+void pivot(BasicMatrix<T> &All, int ROW, int COL) {
+  const int W = ScalarTraits<T>::simdWidth;
+  int rows = All.getRow();
+  int cols = All.getCol();
+  T *pr = &All[ROW][0];
+  T p = pr[COL];
+  for (int j = 0; j < cols; j++) {
+    pr[j] /= p;
+  }
+  for (int i = 0; i < rows; i++) {
+    if (i == ROW) continue;
+    T *ri = &All[i][0];
+    T d = ri[COL];
+    if (d == 0) continue;
+    int j = 0;
+    for (; j + W <= cols; j += W) {
+      for (int k = 0; k < W; k++) {
+        ri[j+k] -= d * pr[j+k];
+      }
+    }
+    for (; j < cols; j++) {
+      ri[j] -= d * pr[j];
+    }
+  }
+}
+
+// pivotと同じ掃き出しをしながら, 最急辺規則の重み weight[j] = 1 + ||B^{-1}a_j||^2
+// ([0, cols)列, 制約は[0, m)行)を漸化式で更新する(Goldfarb-Reid). t_j = 掃き出した
+// 後のROW行, u_j = (掃き出す前の列COL)^T(列j), g = 1 + ||列COL||^2 として
+// w_j <- max(w_j - 2 t_j u_j + t_j^2 g, 1 + t_j^2). uは掃き出しと同じ走査で
+// 集めるので, 表を読み直すのは重みを最初に計算する時だけ
+template <class T>
+static void pivot(BasicMatrix<T> &All, int ROW, int COL, int m, int cols, BasicVector<T> &weight,
+                  BasicVector<T> &u) {
+  const int W = ScalarTraits<T>::simdWidth;
+  int rows = All.getRow();
+  int width = All.getCol();
+  T *uj = &u[0];
+  T *pr = &All[ROW][0];
+  T p = pr[COL];
+  for (int j = 0; j < cols; j++) {
+    uj[j] = p * pr[j];
+  }
+  for (int j = 0; j < width; j++) {
+    pr[j] /= p;
+  }
+  for (int i = 0; i < rows; i++) {
+    if (i == ROW) continue;
+    T *ri = &All[i][0];
+    T d = ri[COL];
+    if (d == 0) continue;
+    int j = 0;
+    if (i < m) {
+      for (; j + W <= cols; j += W) {
+        for (int k = 0; k < W; k++) {
+          T a = ri[j+k];
+          uj[j+k] += d * a;
+          ri[j+k] = a - d * pr[j+k];
+        }
+      }
+      for (; j < cols; j++) {
+        T a = ri[j];
+        uj[j] += d * a;
+        ri[j] = a - d * pr[j];
+      }
+    }
+    for (; j + W <= width; j += W) {
+      for (int k = 0; k < W; k++) {
+        ri[j+k] -= d * pr[j+k];
+      }
+    }
+    for (; j < width; j++) {
+      ri[j] -= d * pr[j];
+    }
+  }
+  T g = 1 + uj[COL];
+  T *w = &weight[0];
+  for (int j = 0; j < cols; j++) {
+    T t = pr[j];
+    if (t == 0) continue;
+    w[j] = std::max(w[j] - 2 * t * uj[j] + t * t * g, 1 + t * t);
+  }
+  w[COL] = 2;
+}
+
+// 表の外にある列vをAllの(ROW, COL)でのピボットに合わせて掃き出す(pivotより前に呼ぶ)
+template <class T>
+static void pivotColumn(const BasicMatrix<T> &All, BasicVector<T> &v, int ROW, int COL) {
+  int rows = All.getRow();
+  T r = v[ROW] / All[ROW][COL];
+  for (int i = 0; i < rows; i++) {
+    if (i != ROW) v[i] -= All[i][COL] * r;
+  }
+  v[ROW] = r;
+}
+
+// 右辺に負の値がある双対実行可能な表(目的関数の行が0以上)を双対単体法で
+// 主実行可能にする. スラック変数は[slack, slack+m)列. 実行不可能なら
+// 出せない行のスラック変数の列をファルカスの証明としてresultに残す
+template <class T>
+static SolveStatus dualSimplex(BasicMatrix<T> &All, int m, int obj, int cols, int rhs, int slack,
+                               int *basis, const Budget<T> &budget, SimplexResult<T> &result) {
+  const T tol = ScalarTraits<T>::nearlyZero();
+  while (true) {
+    All.cleanup();
+    // 右辺の負の値の二乗をB^{-1}の行(スラック変数の列)のノルムの二乗で割った値が
+    // 最大の行を基底から出す(双対最急辺規則, 重みは毎回計算し直す)
+    T R = 0;
+    int RI = -1;
+    for (int i = 0; i < m; i++) {
+      T v = All[i][rhs];
+      if (v >= -tol) continue;
+      const T *r = &All[i][slack];
+      T w = 0;
+      for (int k = 0; k < m; k++) w += r[k] * r[k];
+      RI = (chmax(R, v * v / w) ? i : RI);
+    }
+    if (RI == -1) break;
+
+    // 双対実行可能性を保つ列を入れる
+    T Q = std::numeric_limits<T>::max();
+    int QI = -1;
+    for (int j = 0; j < cols; j++) {
+      if (All[RI][j] < -tol) {
+        QI = (chmin(Q, All[obj][j] / -All[RI][j]) ? j : QI);
+      }
+    }
+
+    // 行RIは y = All[RI][slack, slack+m) について y \geq 0, y^TA \geq 0, y^Tb < 0
+    if (QI == -1) {
+      result.farkas.setSize(m);
+      for (int k = 0; k < m; k++) {
+        result.farkas[k] = All[RI][slack+k];
+      }
+      return SOLVE_INFEASIBLE;
+    }
+
+    SolveStatus stop = budget.check(All, m, obj, rhs);
+    if (stop != SOLVE_OPTIMAL) return stop;
+    pivot(All, RI, QI);
+    if (basis) basis[RI] = QI;
+    result.stats.iterations++;
+  }
+  return SOLVE_OPTIMAL;
+}
+
+// 制約は[0, m)行, 目的関数はobj行, 変数は[0, cols)列, 右辺はrhs列にある表を
+// 最適になるまで掃き出す. スラック変数は[slack, slack+m)列(その前が元の変数).
+// basisが0でなければ各行の基底変数を更新し, 非有界なら方向をresultに残す.
+// 退化したピボット(増分0)がopt.stallLimit回続いたら右辺に小さな乱数を加え,
+// それでも続けば非退化のピボットが出るまでブランドの規則を使う.
+// 摂動を加えていない右辺はshadowで同じように掃き出しておき, 最後に戻す.
+// 予算が尽きたら摂動を戻した今の表のまま止まる. 右辺の負の値は呼び出し側で
+// restoreFeasibilityが戻しておく(残るのは誤差の範囲の値だけで, 0にして摂動として扱う)
+template <class T>
+static SolveStatus primalSimplex(BasicMatrix<T> &All, int m, int obj, int cols, int rhs, int slack,
+                                 int *basis, const SimplexOptions<T> &opt, const Budget<T> &budget,
+                                 SimplexResult<T> &result) {
+  SimplexStats &stats = result.stats;
+  const T tol = ScalarTraits<T>::nearlyZero();
+  // 第二段階(目的関数の行がm行目)だけopt.optimalityで打ち切る. どの規則も候補は
+  // d_j < -optimality の列だけなので, 選んだ列は必ず打ち切りの判定を通る
+  const T optimality = (obj == m && opt.optimality > 0) ? opt.optimality : tol;
+  BasicVector<T> shadow;
+  BasicVector<T> weight, u;
+  bool weighted = false;        /* weightが今の表のもの(ブランドの規則のピボットでは更新しない) */
+  bool perturbed = false;       /* 右辺がshadowと違う */
+  bool randomized = false;      /* 乱数の摂動を加えた */
+  // 前の呼び出しで退化したピボットが続いたまま止まっていればブランドの規則から始める
+  long stall = result.stall;
+  bool bland = opt.pricing == PRICING_BLAND || stall >= opt.stallLimit;
+  result.stall = 0;
+  for (int i = 0; i < m; i++) {
+    if (All[i][rhs] >= 0 || All[i][rhs] < -tol) continue;
+    if (!perturbed) {
+      shadow.setSize(All.getRow());
+      for (int k = 0; k < All.getRow(); k++) {
+        shadow[k] = All[k][rhs];
+      }
+      perturbed = true;
+    }
+    All[i][rhs] = 0;
+  }
+  while (true) {
+    // 誤差消去
+    All.cleanup();
+    // 目的関数の係数最大(実際は符号が反転しているので最小)の変数を見つける
+    T S = 0;
+    int SI = -1;
+
+    if (!bland && opt.pricing == PRICING_STEEPEST_EDGE) {
+      // 最急辺規則: 列の長さ 1 + ||B^{-1}a_j||^2 で割った係数の二乗が最大の列.
+      // 重みは表全体から一度だけ計算し, 後はピボットで更新する
+      if (!weighted) {
+        weight.setSize(cols);
+        u.setSize(cols);
+        for (int j = 0; j < cols; j++) {
+          weight[j] = 1;
+        }
+        for (int i = 0; i < m; i++) {
+          const T *r = &All[i][0];
+          for (int j = 0; j < cols; j++) {
+            weight[j] += r[j] * r[j];
+          }
+        }
+        weighted = true;
+      }
+      T best = 0;
+      for (int j = 0; j < cols; j++) {
+        T d = All[obj][j];
+        if (d < -optimality && chmax(best, d * d / weight[j])) {
+          S = d;
+          SI = j;
+        }
+      }
+    } else if (!bland) {
+      // 最大係数規則
+      for (int j = 0; j < cols; j++) {
+        SI = (chmin(S, All[obj][j]) ? j : SI);
+      }
+    } else {
+      // ブランドの選択規則
+      for (int j = 0; j < cols; j++) {
+        if (All[obj][j] < -optimality) {
+          SI = (chmin(S, All[obj][j]) ? j : SI);
+          break;
+        }
+      }
+    }
+
+    // 最小の係数が0以上なら終了, 0より小さかったら続ける
+    if (S >= -optimality) break;
+
+    // 変数の最小の可能増分を見つける(ブランドの規則では同じ増分なら添字の小さい基底変数)
+    T P = std::numeric_limits<T>::max();
+    int PI = -1;
+    for (int i = 0; i < m; i++) {
+      if (All[i][SI] > tol) {
+        T ratio = All[i][rhs] / All[i][SI];
+        if (chmin(P, ratio)) {
+          PI = i;
+        } else if (bland && ratio == P && basis && basis[i] < basis[PI]) {
+          PI = i;
+        }
+      }
+    }
+
+    // SI列を1増やし, 各行の基底変数を-All[i][SI]だけ動かす方向には制約がない
+    if (PI == -1) {
+      if (perturbed) {
+        for (int i = 0; i < All.getRow(); i++) {
+          All[i][rhs] = shadow[i];
+        }
+      }
+      // (制約がなければ方向は e_SI)
+      if (basis || m == 0) {
+        result.ray.setSize(slack);
+        if (SI < slack) result.ray[SI] = 1;
+        for (int i = 0; i < m; i++) {
+          if (basis[i] >= 0 && basis[i] < slack) result.ray[basis[i]] = -All[i][SI];
+        }
+      }
+      return SOLVE_UNBOUNDED;
+    }
+
+    SolveStatus stop = budget.check(All, m, obj, rhs);
+    if (stop != SOLVE_OPTIMAL) {
+      // 乱数の摂動は戻すので, 続きはブランドの規則から始める
+      result.stall = randomized ? std::max(stall, (long)opt.stallLimit) : stall;
+      if (perturbed) {
+        for (int i = 0; i < All.getRow(); i++) {
+          All[i][rhs] = shadow[i];
+        }
+      }
+      return stop;
+    }
+
+    if (perturbed) pivotColumn(All, shadow, PI, SI);
+    if (weighted && !bland) {
+      pivot(All, PI, SI, m, cols, weight, u);
+    } else {
+      pivot(All, PI, SI);
+      weighted = false;
+    }
+    if (basis) basis[PI] = SI;
+    stats.iterations++;
+
+    if (P > tol) {
+      stall = 0;
+      bland = opt.pricing == PRICING_BLAND;
+      continue;
+    }
+    stats.degeneratePivots++;
+    if (bland) stats.blandPivots++;
+    stall++;
+    if (stall > stats.longestStall) stats.longestStall = stall;
+    if (stall < opt.stallLimit || bland) continue;
+
+    if (!randomized) {
+      // 右辺にb_i += perturbation * (1 + |b_i|) * U[0.5, 1)の摂動を加える
+      if (!perturbed) {
+        shadow.setSize(All.getRow());
+        for (int i = 0; i < All.getRow(); i++) {
+          shadow[i] = All[i][rhs];
+        }
+      }
+      std::mt19937 mt(opt.seed);
+      std::uniform_real_distribution<double> dist(0.5, 1.0);
+      for (int i = 0; i < m; i++) {
+        All[i][rhs] += opt.perturbation * (1 + std::fabs(All[i][rhs])) * T(dist(mt));
+      }
+      perturbed = true;
+      randomized = true;
+      stats.perturbations++;
+    } else {
+      bland = true;
+    }
+    stall = 0;
+  }
+
+  if (!perturbed) return SOLVE_OPTIMAL;
+  // 摂動を取り除く. 基底解が負になった行は双対単体法で戻す
+  for (int i = 0; i < All.getRow(); i++) {
+    All[i][rhs] = shadow[i];
+  }
+  return dualSimplex(All, m, obj, cols, rhs, slack, basis, budget, result);
+}
+
+// 第一段階と第二段階を一つの表で行う.
+// Sub(=All)は(m+2)行: [0, m)行が制約, m行が元の目的関数, m+1行が補助問題の目的関数.
+// 列は[0, n)が元の変数, [n, n+m)がスラック変数, [n+m, n+m+cnt)が人工変数, 最後が右辺.
+// 第一段階の後に人工変数の列と補助問題の行をその場で切り落とす
+template <class T>
+static SolveStatus phaseOne(BasicMatrix<T> &Sub, Basis &basis, int n, const SimplexOptions<T> &opt,
+                            const Budget<T> &budget, SimplexResult<T> &r) {
+  int m = (int)basis.size();
+  int rhs = Sub.getCol() - 1;
+  r.status = primalSimplex(Sub, m, m+1, rhs, rhs, n, m ? &basis[0] : (int *)0, opt, budget, r);
+
+  // 補助問題の最適値が負なら, 補助問題の行のスラック変数の列 y が
+  // y \geq 0, y^TA \geq 0, y^Tb < 0 を満たす
+  if (r.status == SOLVE_OPTIMAL && Sub[m+1][rhs] < -ScalarTraits<T>::nearlyZero()) {
+    r.status = SOLVE_INFEASIBLE;
+    r.farkas.setSize(m);
+    for (int k = 0; k < m; k++) {
+      r.farkas[k] = Sub[m+1][n+k];
+    }
+  }
+  if (r.status != SOLVE_OPTIMAL) {
+    if (opt.diagnostic) opt.diagnostic(r.status, Sub);
+    return r.status;
+  }
+
+  // 値0で基底に残った人工変数を元の変数かスラック変数と入れ替える
+  for (int i = 0; i < m; i++) {
+    if (basis[i] < n+m) continue;
+    int COL = -1;
+    T best = ScalarTraits<T>::nearlyZero();
+    for (int j = 0; j < n+m; j++) {
+      if (chmax(best, std::fabs(Sub[i][j]))) COL = j;
+    }
+    // 見つからなければ冗長な行なので, 全て0の行として基底変数なし(-1)にする
+    if (COL == -1) {
+      basis[i] = -1;
+      continue;
+    }
+    pivot(Sub, i, COL);
+    basis[i] = COL;
+  }
+
+  // 右辺を人工変数の先頭の列に移し, 人工変数の列と補助問題の行を落とす
+  for (int i = 0; i < m+1; i++) {
+    Sub[i][n+m] = Sub[i][rhs];
+  }
+  Sub.shrink(m+1, n+m+1);
+  return SOLVE_OPTIMAL;
+}
+
+// 止まった表(摂動を戻した表や双対単体法の途中の表)の右辺に負の値があれば
+// 主実行可能に戻す. 最後の行の目的関数が双対実行可能なら双対単体法で戻し,
+// そうでなければ負の行の符号を反転して人工変数を加え, 第一段階の(m+2)行の表に
+// する(解くのはphaseOne). 表はm+1行かm+2行で, スラック変数は[n, n+m)列
+template <class T>
+static SolveStatus restoreFeasibility(BasicMatrix<T> &All, Basis &basis, int n, const Budget<T> &budget,
+                                      SimplexResult<T> &r) {
+  int m = (int)basis.size();
+  int obj = All.getRow() - 1;
+  int cols = All.getCol() - 1;
+  const T tol = ScalarTraits<T>::nearlyZero();
+  int cnt = 0;
+  for (int i = 0; i < m; i++) {
+    if (All[i][cols] < -tol) cnt++;
+  }
+  if (cnt == 0) return SOLVE_OPTIMAL;
+  bool dualFeasible = true;
+  for (int j = 0; j < cols; j++) {
+    if (All[obj][j] < -tol) dualFeasible = false;
+  }
+  if (dualFeasible) return dualSimplex(All, m, obj, cols, cols, n, m ? &basis[0] : (int *)0, budget, r);
+
+  // 人工変数の列は右辺の前に, 補助問題の行はなければ最後に加える
+  All.insertColumns(cols, cnt);
+  if (obj == m) All.insertRows(m+1, 1);
+  int rhs = cols + cnt;
+  for (int i = 0, flag = 0; i < m; i++) {
+    T *s = &All[i][0];
+    if (s[rhs] >= -tol) continue;
+    for (int j = 0; j <= rhs; j++) {
+      s[j] = -s[j];
+    }
+    s[cols+flag] = 1;
+    basis[i] = cols+flag;
+    All[m+1][cols+flag] = 1;
+    All[m+1] -= All[i];
+    flag++;
+  }
+  return SOLVE_OPTIMAL;
+}
+
+template <class T>
+SolveStatus simplexMethod(BasicMatrix<T> &All) {
+  int m = All.getRow() - 1;
+  int n = All.getCol() - 1 - m;
+  SimplexOptions<T> opt;
+  SimplexResult<T> result;
+  const T tol = ScalarTraits<T>::nearlyZero();
+  for (int i = 0; i < m; i++) {
+    if (All[i][n+m] < -tol) {
+      Basis basis = findBasis(All);
+      return simplexMethod(All, basis, opt, &result);
+    }
+  }
+  Budget<T> budget(opt, result.stats);
+  return primalSimplex(All, m, m, n+m, n+m, n, (int *)0, opt, budget, result);
+}
+
+template <class T>
+SolveStatus simplexMethod(BasicMatrix<T> &All, Basis &basis, const SimplexOptions<T> &opt,
+                          SimplexResult<T> *result) {
+  int m = All.getRow() - 1;
+  int n = All.getCol() - 1 - m;
+  if ((int)basis.size() != m) {
+    cout << "error: sizes do not match" << "\n";
+    abort();
+  }
+  SimplexResult<T> local;
+  SimplexResult<T> &r = result ? *result : local;
+  Budget<T> budget(opt, r.stats);
+  r.status = restoreFeasibility(All, basis, n, budget, r);
+  if (r.status == SOLVE_OPTIMAL && All.getRow() == m+2) {
+    r.status = phaseOne(All, basis, n, opt, budget, r);
+    if (r.status != SOLVE_OPTIMAL) return r.status;
+  }
+  if (r.status == SOLVE_OPTIMAL) {
+    r.status = primalSimplex(All, m, m, n+m, n+m, n, m ? &basis[0] : (int *)0, opt, budget, r);
+  }
+  if (r.status != SOLVE_OPTIMAL && opt.diagnostic) opt.diagnostic(r.status, All);
+  return r.status;
+}
+
+template <class T>
+SolveStatus simplexMethod(BasicMatrix<T> &All, Basis &basis) {
+  return simplexMethod(All, basis, SimplexOptions<T>());
+}
+
+// 制約 A_q x \leq b_q の行を目的関数の行の前に, そのスラック変数の列を
+// スラック変数の最後に加える. 行は今の基底の列を消去して表し, 新しい
+// スラック変数を基底にする. 負の右辺は双対単体法で戻す
+template <class T>
+SolveStatus addRows(BasicMatrix<T> &All, Basis &basis, const BasicMatrix<T> &A, const BasicVector<T> &b,
+                    const SimplexOptions<T> &opt, SimplexResult<T> *result) {
+  int m = All.getRow() - 1;
+  int n = All.getCol() - 1 - m;
+  int k = b.getSize();
+  if ((int)basis.size() != m || A.getRow() != k || (k > 0 && A.getCol() != n)) {
+    cout << "error: sizes do not match" << "\n";
+    abort();
+  }
+  All.insertColumns(n+m, k);
+  All.insertRows(m, k);
+  int cols = n+m+k;
+  for (int q = 0; q < k; q++) {
+    T *r = &All[m+q][0];
+    for (int j = 0; j < n; j++) {
+      r[j] = A[q][j];
+    }
+    r[n+m+q] = 1;
+    r[cols] = b[q];
+    for (int i = 0; i < m; i++) {
+      if (basis[i] < 0) continue;
+      T d = r[basis[i]];
+      if (d == 0) continue;
+      const T *ri = &All[i][0];
+      for (int j = 0; j <= cols; j++) {
+        r[j] -= d * ri[j];
+      }
+    }
+    basis.push_back(n+m+q);
+  }
+
+  SimplexResult<T> local;
+  SimplexResult<T> &res = result ? *result : local;
+  m += k;
+  Budget<T> budget(opt, res.stats);
+  res.status = dualSimplex(All, m, m, cols, cols, n, m ? &basis[0] : (int *)0, budget, res);
+  // 双対単体法の後に誤差で残った負の被約費用を主単体法で片付ける
+  if (res.status == SOLVE_OPTIMAL) {
+    res.status = primalSimplex(All, m, m, cols, cols, n, m ? &basis[0] : (int *)0, opt, budget, res);
+  }
+  if (res.status != SOLVE_OPTIMAL && opt.diagnostic) opt.diagnostic(res.status, All);
+  return res.status;
+}
+
+template <class T>
+SolveStatus addRows(BasicMatrix<T> &All, Basis &basis, const BasicMatrix<T> &A, const BasicVector<T> &b) {
+  return addRows(All, basis, A, b, SimplexOptions<T>());
+}
+
+// スラック変数が基底にある制約(効いていない制約)の行とスラック変数の列を
+// 落とす. 他の行のその列は0なので, 残りの表はそのまま最適
+template <class T>
+int removeRows(BasicMatrix<T> &All, Basis &basis, const std::vector<int> &rows) {
+  int m = All.getRow() - 1;
+  int n = All.getCol() - 1 - m;
+  if ((int)basis.size() != m) {
+    cout << "error: sizes do not match" << "\n";
+    abort();
+  }
+  // 落とす制約kごとに, スラック変数n+kが基底にある表の行
+  std::vector<int> rowOf(m, -1);
+  for (int i = 0; i < m; i++) {
+    if (basis[i] >= n) rowOf[basis[i]-n] = i;
+  }
+  std::vector<bool> dropRow(m+1, false), dropCol(n+m+1, false);
+  int removed = 0;
+  for (size_t q = 0; q < rows.size(); q++) {
+    int k = rows[q];
+    if (k < 0 || k >= m || rowOf[k] == -1 || dropCol[n+k]) continue;
+    dropRow[rowOf[k]] = true;
+    dropCol[n+k] = true;
+    removed++;
+  }
+  if (removed == 0) return 0;
+
+  // 列を詰め, 残す行を上に詰める(目的関数の行は最後のまま)
+  std::vector<int> shift(n+m+1, 0);
+  for (int j = 0, d = 0; j <= n+m; j++) {
+    if (dropCol[j]) d++;
+    shift[j] = d;
+  }
+  int row = 0;
+  for (int i = 0; i <= m; i++) {
+    if (dropRow[i]) continue;
+    T *r = &All[i][0];
+    for (int j = 0, w = 0; j <= n+m; j++) {
+      if (!dropCol[j]) r[w++] = r[j];
+    }
+    if (row != i) All[row].swap(All[i]);
+    if (i < m) {
+      int j = basis[i];
+      basis[row] = (j < 0) ? -1 : j - shift[j];
+    }
+    row++;
+  }
+  All.shrink(m+1-removed, n+m+1-removed);
+  basis.resize(m-removed);
+  return removed;
+}
+
+// 目標の基底にない列が基底にある行のうち, 入れる列の絶対値が最大の行で
+// ピボットする. 入れる順は目標の順
+template <class T>
+int installBasis(BasicMatrix<T> &All, Basis &basis, const Basis &target) {
+  int m = All.getRow() - 1;
+  int n = All.getCol() - 1 - m;
+  if ((int)basis.size() != m) {
+    cout << "error: sizes do not match" << "\n";
+    abort();
+  }
+  std::vector<bool> wanted(n+m, false), basic(n+m, false);
+  for (size_t q = 0; q < target.size(); q++) {
+    if (target[q] >= 0 && target[q] < n+m) wanted[target[q]] = true;
+  }
+  for (int i = 0; i < m; i++) {
+    if (basis[i] >= 0) basic[basis[i]] = true;
+  }
+  int missed = 0;
+  for (size_t q = 0; q < target.size(); q++) {
+    int j = target[q];
+    if (j < 0 || j >= n+m || basic[j]) continue;
+    int row = -1;
+    T best = ScalarTraits<T>::nearlyZero();
+    for (int i = 0; i < m; i++) {
+      if (basis[i] >= 0 && wanted[basis[i]]) continue;
+      if (chmax(best, (T)std::fabs(All[i][j]))) row = i;
+    }
+    if (row < 0) {
+      missed++;
+      continue;
+    }
+    pivot(All, row, j);
+    if (basis[row] >= 0) basic[basis[row]] = false;
+    basis[row] = j;
+    basic[j] = true;
+  }
+  return missed;
+}
+
+// クラッシュで入れる列のピボットは, 列の(制約の行での)最大の絶対値のこの倍以上
+template <class T>
+static T crashPivot() {
+  return T(0.1);
+}
+
+// LTSF(疎な行から)風のクラッシュ: 基底がスラック変数のまま右辺が負の行のうち,
+// 負の要素が最も少ない行を選び, 負で列の最大のcrashPivot倍以上の要素の列のうち
+// 掃き出した後の負の右辺の和の減り幅が最大の半分以上の列から
+// 目的関数の係数が最も良い列を入れる. 和が減らなければその行は諦める.
+// 表の上で掃き出すので三角に限らない. 1列ごとにO(m(n+m))
+template <class T>
+static void ltsfCrash(BasicMatrix<T> &All, Basis &basis, int n, SimplexStats &stats) {
+  int m = (int)basis.size();
+  int rhs = n+m;
+  const T tol = ScalarTraits<T>::nearlyZero();
+  std::vector<bool> tried(m, false), used(n, false);
+  BasicVector<T> theta(n), after(n), big(n);
+  while (true) {
+    int ROW = -1, fewest = n+1;
+    for (int i = 0; i < m; i++) {
+      if (tried[i] || basis[i] < n || All[i][rhs] >= -tol) continue;
+      int count = 0;
+      for (int j = 0; j < n; j++) {
+        if (!used[j] && All[i][j] < -tol) count++;
+      }
+      if (count > 0 && (count < fewest || (count == fewest && All[i][rhs] < All[ROW][rhs]))) {
+        ROW = i;
+        fewest = count;
+      }
+    }
+    if (ROW == -1) break;
+    tried[ROW] = true;
+
+    T infeasibility = 0;
+    for (int i = 0; i < m; i++) {
+      if (All[i][rhs] < 0) infeasibility -= All[i][rhs];
+    }
+    // 候補の列jごとに, 掃き出した後の負の右辺の和と列の最大を行の順に集める
+    const T *r = &All[ROW][0];
+    for (int j = 0; j < n; j++) {
+      theta[j] = (!used[j] && r[j] < -tol) ? r[rhs] / r[j] : T(0);
+      after[j] = 0;
+      big[j] = 0;
+    }
+    for (int i = 0; i < m; i++) {
+      if (i == ROW) continue;
+      const T *a = &All[i][0];
+      T v = a[rhs];
+      for (int j = 0; j < n; j++) {
+        T w = v - a[j] * theta[j];
+        after[j] -= w < 0 ? w : T(0);
+        big[j] = std::max(big[j], (T)std::fabs(a[j]));
+      }
+    }
+    T least = infeasibility - tol;
+    int COL = -1;
+    for (int j = 0; j < n; j++) {
+      if (theta[j] == 0 || -r[j] < crashPivot<T>() * std::max(big[j], -r[j])) {
+        after[j] = -1;
+        continue;
+      }
+      if (chmin(least, after[j])) COL = j;
+    }
+    if (COL == -1) continue;
+    T limit = (infeasibility + least) / 2;
+    T S = All[m][COL];
+    for (int j = 0; j < n; j++) {
+      if (after[j] >= 0 && after[j] <= limit && chmin(S, All[m][j])) COL = j;
+    }
+    pivot(All, ROW, COL);
+    basis[ROW] = COL;
+    used[COL] = true;
+    stats.crashPivots++;
+  }
+}
+
+template <class T>
+SolveStatus subProblem(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                       BasicMatrix<T> &Sub, Basis &basis, const SimplexOptions<T> &opt,
+                       SimplexResult<T> *result) {
+  int m = b.getSize();
+  int n = c.getSize();
+  SimplexResult<T> local;
+  SimplexResult<T> &r = result ? *result : local;
+  // 初期の表(スラック変数の基底)とクラッシュ
+  BasicMatrix<T> All = createMatrix(A, b, c, basis);
+  if (opt.crash == CRASH_LTSF) ltsfCrash(All, basis, n, r.stats);
+
+  // 右辺が負の行に人工変数を加え, 行の符号を反転する
+  int cnt = 0;
+  for (int i = 0; i < m; i++) {
+    if (All[i][n+m] < 0) cnt++;
+  }
+  int rhs = n+m+cnt;
+  Sub.setSize(m+2, n+m+cnt+1);
+  int flag = 0;
+  for (int i = 0; i <= m; i++) {
+    const T *a = &All[i][0];
+    T *s = &Sub[i][0];
+    bool negative = i < m && a[n+m] < 0;
+    T sign = negative ? -1 : 1;
+    for (int j = 0; j < n+m; j++) {
+      s[j] = sign * a[j];
+    }
+    s[rhs] = sign * a[n+m];
+    if (negative) {
+      s[n+m+flag] = 1;
+      basis[i] = n+m+flag;
+      flag++;
+    }
+  }
+  for (int j = n+m; j < n+m+cnt; j++) {
+    Sub[m+1][j] = 1;
+  }
+  for (int i = 0; i < m; i++) {
+    if (basis[i] >= n+m) Sub[m+1] -= Sub[i];
+  }
+
+  Budget<T> budget(opt, r.stats);
+  return phaseOne(Sub, basis, n, opt, budget, r);
+}
+
+template <class T>
+SolveStatus subProblem(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                       BasicMatrix<T> &All, Basis &basis) {
+  return subProblem(A, b, c, All, basis, SimplexOptions<T>());
+}
+
+template <class T>
+SolveStatus subProblem(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                       BasicMatrix<T> &All) {
+  Basis basis;
+  return subProblem(A, b, c, All, basis);
+}
+
+// 止まった表の続きを解く. (m+2)行の表は第一段階を終えてから第二段階に進む
+template <class T>
+SolveStatus resume(BasicMatrix<T> &All, Basis &basis, int n, const SimplexOptions<T> &opt,
+                   SimplexResult<T> *result) {
+  int m = (int)basis.size();
+  if ((All.getRow() != m+1 && All.getRow() != m+2) || All.getCol() < n+m+1) {
+    cout << "error: sizes do not match" << "\n";
+    abort();
+  }
+  SimplexResult<T> local;
+  SimplexResult<T> &r = result ? *result : local;
+  Budget<T> budget(opt, r.stats);
+  // 負の右辺を戻す. m+1行の表に第一段階の行が加わることもある
+  if (All.getRow() == m+1) n = All.getCol() - 1 - m;
+  r.status = restoreFeasibility(All, basis, n, budget, r);
+  if (r.status != SOLVE_OPTIMAL) {
+    if (opt.diagnostic) opt.diagnostic(r.status, All);
+    return r.status;
+  }
+  if (All.getRow() == m+2) {
+    r.status = phaseOne(All, basis, n, opt, budget, r);
+    if (r.status != SOLVE_OPTIMAL) return r.status;
+  }
+  int cols = All.getCol() - 1;
+  r.status = primalSimplex(All, m, m, cols, cols, cols-m, m ? &basis[0] : (int *)0, opt, budget, r);
+  if (r.status != SOLVE_OPTIMAL && opt.diagnostic) opt.diagnostic(r.status, All);
+  return r.status;
+}
+
+// 入力行列を作る(bに負の要素がある場合はsubProblemを使う)
+template <class T>
+BasicMatrix<T> createMatrix(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c) {
+  int m = b.getSize();
+  int n = c.getSize();
+  BasicMatrix<T> All(m+1, n+m+1);
+  for (int i = 0; i < m+1; i++) {
+    for (int j = 0; j < n+m+1; j++) {
+      if (i < m && j < n) All[i][j] = A[i][j];
+      else if (i < m && j >= n && j < n+m) All[i][j] = (j-n == i) ? 1 : 0;
+      else if (i < m && j == n+m) All[i][j] = b[i];
+      else if (i == m && j < n) All[i][j] = -c[j];
+      else if (i == m && j >= n) All[i][j] = 0;
+    }
+  }
+  return All;
+}
+
+template <class T>
+BasicMatrix<T> createMatrix(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                            Basis &basis) {
+  int m = b.getSize();
+  int n = c.getSize();
+  basis.resize(m);
+  for (int i = 0; i < m; i++) {
+    basis[i] = n+i;
+  }
+  return createMatrix(A, b, c);
+}
+
+// 基底変数の列(単位ベクトルになっている列)を探す. O(m(n+m))
+template <class T>
+Basis findBasis(const BasicMatrix<T> &All) {
+  int m = All.getRow() - 1;
+  int n = All.getCol() - 1 - m;
+  const T tol = ScalarTraits<T>::nearlyZero();
+  Basis basis(m, -1);
+  for (int j = 0; j < n+m; j++) {
+    if (std::fabs(All[m][j]) > tol) continue;
+    int row = -1;
+    for (int i = 0; i < m; i++) {
+      T a = All[i][j];
+      if (std::fabs(a - 1) <= tol && row == -1) {
+        row = i;
+      } else if (std::fabs(a) > tol) {
+        row = -1;
+        break;
+      }
+    }
+    if (row != -1 && basis[row] == -1) basis[row] = j;
+  }
+  return basis;
+}
+
+// 基底と目的関数の行から解を読み出す. O(m+n)
+template <class T>
+Solution<T> getSolution(const BasicMatrix<T> &All, const Basis &basis) {
+  int m = All.getRow() - 1;
+  int n = All.getCol() - 1 - m;
+  Solution<T> sol = {BasicVector<T>(n), BasicVector<T>(m), BasicVector<T>(m),
+                     BasicVector<T>(n), All[m][n+m]};
+  for (int i = 0; i < m; i++) {
+    int j = basis[i];
+    if (j < 0) continue;
+    if (j < n) sol.x[j] = All[i][n+m];
+    else sol.slack[j-n] = All[i][n+m];
+  }
+  for (int i = 0; i < m; i++) {
+    sol.dual[i] = All[m][n+i];
+  }
+  for (int j = 0; j < n; j++) {
+    sol.reducedCost[j] = All[m][j];
+  }
+  return sol;
+}
+
+// 結果出力
+template <class T>
+void showResult(const BasicMatrix<T> &All, const Basis &basis) {
+  Solution<T> sol = getSolution(All, basis);
+  cout << "X: " << sol.x;
+  cout << "f: " << sol.f << endl;
+}
+
+template <class T>
+void showResult(const BasicMatrix<T> &All) {
+  showResult(All, findBasis(All));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//                          explicit instantiation                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#define INSTANTIATE_SIMPLEX(T)                                                 \
+  template SolveStatus simplexMethod(BasicMatrix<T> &);                        \
+  template SolveStatus simplexMethod(BasicMatrix<T> &, Basis &);               \
+  template SolveStatus simplexMethod(BasicMatrix<T> &, Basis &, const SimplexOptions<T> &, \
+                                     SimplexResult<T> *);                      \
+  template SolveStatus subProblem(const BasicMatrix<T> &, const BasicVector<T> &, const BasicVector<T> &, \
+                                  BasicMatrix<T> &);                           \
+  template SolveStatus subProblem(const BasicMatrix<T> &, const BasicVector<T> &, const BasicVector<T> &, \
+                                  BasicMatrix<T> &, Basis &);                  \
+  template SolveStatus subProblem(const BasicMatrix<T> &, const BasicVector<T> &, const BasicVector<T> &, \
+                                  BasicMatrix<T> &, Basis &, const SimplexOptions<T> &, \
+                                  SimplexResult<T> *);                         \
+  template BasicMatrix<T> createMatrix(const BasicMatrix<T> &, const BasicVector<T> &, const BasicVector<T> &); \
+  template BasicMatrix<T> createMatrix(const BasicMatrix<T> &, const BasicVector<T> &, const BasicVector<T> &, \
+                                       Basis &);                               \
+  template SolveStatus resume(BasicMatrix<T> &, Basis &, int, const SimplexOptions<T> &, SimplexResult<T> *); \
+  template SolveStatus addRows(BasicMatrix<T> &, Basis &, const BasicMatrix<T> &, const BasicVector<T> &); \
+  template SolveStatus addRows(BasicMatrix<T> &, Basis &, const BasicMatrix<T> &, const BasicVector<T> &, \
+                               const SimplexOptions<T> &, SimplexResult<T> *); \
+  template int removeRows(BasicMatrix<T> &, Basis &, const std::vector<int> &); \
+  template int installBasis(BasicMatrix<T> &, Basis &, const Basis &);         \
+  template void pivot(BasicMatrix<T> &, int, int);                             \
+  template Basis findBasis(const BasicMatrix<T> &);                            \
+  template Solution<T> getSolution(const BasicMatrix<T> &, const Basis &);     \
+  template void showResult(const BasicMatrix<T> &, const Basis &);             \
+  template void showResult(const BasicMatrix<T> &);
+
+INSTANTIATE_SIMPLEX(float)
+INSTANTIATE_SIMPLEX(double)
+INSTANTIATE_SIMPLEX(long double)
@@ -0,0 +1,216 @@
+#pragma once
+#include "matrix.hpp"
+#include <atomic>
+#include <vector>
+#include <functional>
+
+// maximize c^Tx s.t. Ax \leq b and x \geq 0
+//
+// All is the (m+1) x (n+m+1) tableau [A I b; -c 0 0]. Every routine is a
+// template on the scalar type and is instantiated for float, double and
+// long double; tolerances follow ScalarTraits<T>.
+
+// basis header: basis[i] is the column basic in row i of the tableau
+// (-1 for a redundant all-zero row left behind by phase 1)
+typedef std::vector<int> Basis;
+
+// solution read from the basis header and the objective row
+template <class T>
+struct Solution {
+  BasicVector<T> x;             /* primal, n */
+  BasicVector<T> slack;         /* b - Ax, m */
+  BasicVector<T> dual;          /* dual price y of each row, m */
+  BasicVector<T> reducedCost;   /* y^TA_j - c_j (\geq 0 at optimum), n */
+  T f;                          /* c^Tx */
+};
+
+// outcome of a solve; nothing is printed or thrown
+enum SolveStatus {
+  SOLVE_OPTIMAL,
+  SOLVE_UNBOUNDED,
+  SOLVE_INFEASIBLE,
+  SOLVE_ITERATION_LIMIT,        /* SimplexOptions::maxIterations, or the interior point method's limit */
+  SOLVE_CANCELLED,              /* CancelToken::cancel() was called */
+  SOLVE_TIME_LIMIT,             /* SimplexOptions::timeLimit */
+  SOLVE_NUMERICAL               /* an answer was reached but failed its residual check (raceStrategies) */
+};
+// A simplex solve stopped by a limit or a token leaves the tableau and the
+// basis at the last basis reached; resume continues from there.
+
+// rule choosing the entering column of the primal simplex method
+enum PricingRule {
+  PRICING_DANTZIG,              /* most negative reduced cost */
+  PRICING_STEEPEST_EDGE,        /* largest d_j^2 / (1 + ||B^{-1}a_j||^2), norms updated by recurrence */
+  PRICING_BLAND                 /* smallest index (never cycles, usually slow) */
+};
+
+// starting basis of subProblem. Every row whose basic value is negative in
+// the start gets an artificial variable, so structural columns that make
+// such a row nonnegative save phase 1 the pivots that drive it out. Columns
+// enter only rows with b_i < 0 (the all-slack start of createMatrix is
+// already feasible) and only on a pivot of at least 0.1 times the largest
+// entry of the column
+enum CrashRule {
+  CRASH_NONE,                   /* slack variables and one artificial per row with b_i < 0 */
+  CRASH_LTSF                    /* sparsest row first, pivoted in the tableau while the infeasibility drops */
+};
+
+// 他のスレッドから解くのを止めるための旗. parentが止められても止まる
+class CancelToken {
+ public:
+  explicit CancelToken(const CancelToken *parent = 0) : flag(false), parent(parent) {}
+  void cancel() { flag.store(true, std::memory_order_relaxed); }
+  bool cancelled() const {
+    return flag.load(std::memory_order_relaxed) || (parent && parent->cancelled());
+  }
+
+ private:
+  std::atomic<bool> flag;
+  const CancelToken *parent;
+};
+
+// state reported to SimplexOptions::progress
+template <class T>
+struct SimplexProgress {
+  long iterations;              /* pivots of this call so far */
+  T objective;                  /* value of the objective row (c^Tx of the current basis) */
+  T infeasibility;              /* phase 1: sum of the artificial variables, else sum of negative basic values */
+  double elapsed;               /* [s] since the start of this call */
+};
+
+// degeneracy handling of the simplex method: after stallLimit zero-step
+// pivots in a row b is perturbed by a bounded random amount (removed again at
+// the end, with dual simplex pivots if a basic value turns negative); if the
+// stall persists Bland's rule is used until the next nondegenerate pivot
+template <class T>
+struct SimplexOptions {
+  int stallLimit;               /* zero-step pivots in a row before acting */
+  T perturbation;               /* b_i += perturbation * (1 + |b_i|) * U[0.5, 1) */
+  unsigned seed;                /* seed of the perturbation */
+  PricingRule pricing;
+  CrashRule crash;              /* start of subProblem */
+  // phase 2 stops once every reduced cost is above -optimality (0 is
+  // ScalarTraits<T>::nearlyZero()); phase 1 and its infeasibility verdict keep nearlyZero
+  T optimality;
+  // budget of one call (simplexMethod, subProblem, addRows or resume); 0 is no limit
+  long maxIterations;           /* pivots */
+  double timeLimit;             /* [s] of wall time */
+  const CancelToken *cancel;
+  int checkEvery;               /* cancel, timeLimit and progress are looked at every checkEvery pivots */
+  std::function<void(const SimplexProgress<T> &)> progress;
+  // opt-in hook, called with the final tableau of a solve that is not
+  // SOLVE_OPTIMAL (the (m+2)-row phase 1 tableau for subProblem)
+  std::function<void(SolveStatus, const BasicMatrix<T> &)> diagnostic;
+  SimplexOptions()
+      : stallLimit(50), perturbation(std::pow(std::numeric_limits<T>::epsilon(), T(0.375))), seed(1),
+        pricing(PRICING_DANTZIG), crash(CRASH_NONE), optimality(0), maxIterations(0), timeLimit(0), cancel(0),
+        checkEvery(1) {}
+};
+
+struct SimplexStats {
+  long iterations = 0;          /* pivots, including dual simplex cleanup */
+  long degeneratePivots = 0;    /* pivots with a zero step */
+  long longestStall = 0;        /* longest run of consecutive zero-step pivots */
+  int perturbations = 0;        /* times b was perturbed */
+  long blandPivots = 0;         /* degenerate pivots taken under Bland's rule */
+  long crashPivots = 0;         /* pivots of the crash (not in iterations) */
+};
+
+// status, statistics and the certificate read from the final tableau
+template <class T>
+struct SimplexResult {
+  SolveStatus status = SOLVE_OPTIMAL;
+  SimplexStats stats;
+  BasicVector<T> ray;           /* SOLVE_UNBOUNDED: d \geq 0, Ad \leq 0, c^Td > 0, n */
+  BasicVector<T> farkas;        /* SOLVE_INFEASIBLE: y \geq 0, y^TA \geq 0, y^Tb < 0, m */
+  long stall = 0;               /* zero-step pivots in a row when a limit stopped the solve */
+};
+
+// 単体法(最適になるまでAllをその場で掃き出す). 非有界ならSOLVE_UNBOUNDED
+template <class T>
+SolveStatus simplexMethod(BasicMatrix<T> &All);
+
+// 基底を更新しながらの単体法
+template <class T>
+SolveStatus simplexMethod(BasicMatrix<T> &All, Basis &basis);
+
+// 退化の扱いと診断用の関数を指定し, resultが0でなければ状態, 統計,
+// 非有界な方向を書き込む(統計は加算)
+template <class T>
+SolveStatus simplexMethod(BasicMatrix<T> &All, Basis &basis, const SimplexOptions<T> &opt,
+                          SimplexResult<T> *result = 0);
+
+// bに負の要素がある場合の補助問題を解き, 元の問題の初期表をAllに作る
+// (実行不可能ならSOLVE_INFEASIBLEでファルカスの証明をresultに書き込む).
+// 第一段階は元の目的関数の行も含む一つの表で行い, その表をそのまま
+// 第二段階の初期表にする
+template <class T>
+SolveStatus subProblem(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                       BasicMatrix<T> &All);
+
+template <class T>
+SolveStatus subProblem(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                       BasicMatrix<T> &All, Basis &basis);
+
+template <class T>
+SolveStatus subProblem(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                       BasicMatrix<T> &All, Basis &basis, const SimplexOptions<T> &opt,
+                       SimplexResult<T> *result = 0);
+
+// 予算か中止で止まった解き直し(simplexMethod, addRowsの表, subProblemの第一段階の
+// (m+2)行の表)を最適になるまで続ける. nは元の変数の数. 止まった時と同じresultを
+// 渡せば退化したピボットの回数を引き継ぎ, 小さな予算で繰り返しても巡回しない.
+// 基底変数が負なら, 双対実行可能な表は双対単体法で, そうでなければ人工変数を
+// 加えた第一段階で戻す(表は一時的に(m+2)行になる)
+template <class T>
+SolveStatus resume(BasicMatrix<T> &All, Basis &basis, int n, const SimplexOptions<T> &opt,
+                   SimplexResult<T> *result = 0);
+
+// 最適な表に制約 Ax \leq b (Aは k x n) の行を加え, 双対単体法で解き直す.
+// 新しい制約のスラック変数は[n+m, n+m+k)列, 行はm行目から
+template <class T>
+SolveStatus addRows(BasicMatrix<T> &All, Basis &basis, const BasicMatrix<T> &A, const BasicVector<T> &b);
+
+template <class T>
+SolveStatus addRows(BasicMatrix<T> &All, Basis &basis, const BasicMatrix<T> &A, const BasicVector<T> &b,
+                    const SimplexOptions<T> &opt, SimplexResult<T> *result = 0);
+
+// 制約rows(スラック変数n+kの制約k)のうちスラック変数が基底にあるものを
+// 落とし, 落とした数を返す. 後ろの制約の番号は詰まる
+template <class T>
+int removeRows(BasicMatrix<T> &All, Basis &basis, const std::vector<int> &rows);
+
+// targetの列(m個以下, 順は問わない)を掃き出して基底に入れる. 表とbasisは
+// 最適でなくてよく, 右辺が負になることもある(simplexMethodに渡せば
+// 摂動と双対単体法で片付く). 入れられなかった(残りの行で要素が0に
+// 近い)列の数を返す. 1列ごとにO(m(n+m))
+template <class T>
+int installBasis(BasicMatrix<T> &All, Basis &basis, const Basis &target);
+
+// 表Allの(ROW, COL)をピボットにして目的関数の行も含めた全行を掃き出す
+// (basisは呼び出し側で更新する). O(m(n+m))
+template <class T>
+void pivot(BasicMatrix<T> &All, int ROW, int COL);
+
+// 入力行列を作る(基底はスラック変数)
+template <class T>
+BasicMatrix<T> createMatrix(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c);
+
+template <class T>
+BasicMatrix<T> createMatrix(const BasicMatrix<T> &A, const BasicVector<T> &b, const BasicVector<T> &c,
+                            Basis &basis);
+
+// 基底を持たない表から基底を探す. O(m(n+m))
+template <class T>
+Basis findBasis(const BasicMatrix<T> &All);
+
+// 解(主変数, スラック, 双対価格, 被約費用)を読み出す. O(m+n)
+template <class T>
+Solution<T> getSolution(const BasicMatrix<T> &All, const Basis &basis);
+
+// 結果出力
+template <class T>
+void showResult(const BasicMatrix<T> &All, const Basis &basis);
+
+template <class T>
+void showResult(const BasicMatrix<T> &All);
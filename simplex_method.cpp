@@ -1,7 +1,19 @@
-#include "matrix.hpp"
+#include "simplex.hpp"
+#include "fixed_simplex.hpp"
+#include "interior_point.hpp"
+#include "column_generation.hpp"
+#include "mip.hpp"
+#include "race.hpp"
+#include "mixed_precision.hpp"
+#include "mapped_tableau.hpp"
+#include "decomposition.hpp"
+#include <algorithm>
 #include <random>
 #include <chrono>
 #include <cmath>
+#include <thread>
+#include <tuple>
+#include <vector>
 
 using std::cout;
 using std::endl;
@@ -131,238 +143,88 @@ tuple<Matrix, Vector, Vector> create_unbounded_problem(int m, int n) {
   return make_tuple(T(A), -c, -b);
 }
 
-template<class T> inline bool chmax(T& a, T b) { 
-  if (a < b) {
-    a = b;
-    return true;
-  }
-  return false;
-}
-
-template<class T> inline bool chmin(T& a, T b) {
-  if (a > b) {
-    a = b;
-    return true;
-  }
-  return false;
-}
-
-#define INF 1e5;
-
-Matrix simplexMethod(Matrix &All) {
-  // 誤差消去
-  All.cleanup();
-  // cout << All << endl;
-  int m = All.getRow() - 1;
-  int n = All.getCol() - 1 - m;
-  // 目的関数の係数最大(実際は符号が反転しているので最小)の変数を見つける
-  double S = INF;
-  int SI = -1;
-  
-  // 最大係数規則
-  for (int j = 0; j < m+n; j++) {
-    SI = (chmin(S, All[m][j]) ? j : SI);
-  }
-
-  // ブランドの選択規則
-  // for (int j = 0; j < m+n; j++) {
-  //   if (All[m][j] < 0) {
-  //     SI = (chmin(S, All[m][j]) ? j : SI);
-  //     break;
-  //   }
-  // }
-  
-  // 最小の係数が0以上なら終了, 0より小さかったら続ける
-  if (S < 0) {
-    if (SI == -1) abort();
-
-    // 変数の最小の可能増分を見つける
-    double P = INF;
-    int PI = -1;
-    for (int i = 0; i < m; i++) {
-      if (All[i][SI] > 0) {
-        PI = (chmin(P, All[i][n+m] / All[i][SI]) ? i : PI);
+// K個のブロック(m_k x n_k, 要素の半分が0の一様乱数, b_k \in [1, 2))を
+// m0本の結合制約(一様乱数)でつないだ問題. 原点は実行可能で, 有界
+tuple<std::vector<Block<double> >, Vector> create_block_angular_problem(int K, int mk, int nk, int m0) {
+  random_device rd;
+  mt19937 gen(rd());
+  uniform_real_distribution<double> u(0, 1);
+  std::vector<Block<double> > blocks;
+  for (int k = 0; k < K; k++) {
+    Block<double> block = {Matrix(m0, nk), Matrix(mk, nk), Vector(mk), Vector(nk)};
+    for (int i = 0; i < m0; i++) {
+      for (int j = 0; j < nk; j++) {
+        block.D[i][j] = u(gen);
       }
     }
-
-    if (PI == -1) {
-      cout << "Main problem" << endl;
-      cout << All;
-      throw "unbounded";
-    };
-    
-    // 以下の行, 列をピボットにして掃き出しを行う
-    int ROW = PI;
-    int COL = SI;
-
-    All[ROW] /= All[ROW][COL];
-  
-    for (int i = 0; i < m+1; i++) {
-      if (i == ROW) continue;
-      double d = All[i][COL];
-      for (int j = 0; j < m+n+1; j++) {
-        All[i][j] -= d * All[ROW][j];
-      }
-    } 
-    simplexMethod(All);
-  }
-  
-  return All;
-}
-
-tuple<Matrix, Vector> simplexMethod2(Matrix &All, Vector &Obj) {
-  // 誤差消去
-  All.cleanup();
-  // cout << All << endl;
-  int m = All.getRow() - 1;
-  int n = All.getCol() - 1 - m;
-  // 目的関数の係数最大(実際は符号が反転しているので最小)の変数を見つける
-  double S = INF;
-  int SI = -1;
-  
-  // 最大係数規則
-  for (int j = 0; j < m+n; j++) {
-    SI = (chmin(S, All[m][j]) ? j : SI);
-  }
-
-  // ブランドの選択規則
-  // for (int j = 0; j < m+n; j++) {
-  //   if (All[m][j] < 0) {
-  //     SI = (chmin(S, All[m][j]) ? j : SI);
-  //     break;
-  //   }
-  // }
-  
-  // 最小の係数が0以上なら終了, 0より小さかったら続ける
-  if (S < 0) {
-    if (SI == -1) abort();
-
-    // 変数の最小の可能増分を見つける
-    double P = INF;
-    int PI = -1;
-    for (int i = 0; i < m; i++) {
-      if (All[i][SI] > 0) {
-        PI = (chmin(P, All[i][n+m] / All[i][SI]) ? i : PI);
+    for (int i = 0; i < mk; i++) {
+      for (int j = 0; j < nk; j++) {
+        block.B[i][j] = (u(gen) < 0.5) ? u(gen) : 0;
       }
+      block.b[i] = 1 + u(gen);
     }
-
-    if (PI == -1) {
-      cout << "Main problem" << endl;
-      cout << All;
-      throw "unbounded";
-    };
-    
-    // 以下の行, 列をピボットにして掃き出しを行う
-    int ROW = PI;
-    int COL = SI;
-
-    All[ROW] /= All[ROW][COL];
-  
-    for (int i = 0; i < m+1; i++) {
-      if (i == ROW) continue;
-      double d = All[i][COL];
-      for (int j = 0; j < m+n+1; j++) {
-        All[i][j] -= d * All[ROW][j];
-      }
+    for (int j = 0; j < nk; j++) {
+      block.c[j] = u(gen);
     }
-    Obj -= Obj[COL] * All[ROW];
-    simplexMethod2(All, Obj);
+    blocks.push_back(block);
+  }
+  // 結合制約が効くように, ブロックだけの最適解より小さくする
+  Vector d(m0);
+  for (int i = 0; i < m0; i++) {
+    d[i] = 0.015 * K * nk;
   }
-  
-  return make_tuple(All, Obj);
+  return make_tuple(blocks, d);
 }
 
-Matrix subProblem(const Matrix &A, const Vector &b, const Vector &c) {
-  int m = b.getSize();
-  int n = c.getSize();
-  int cnt = 0;
-  for (int i = 0; i < m; i++) {
-    if (b[i] < 0) cnt++;
+// ブロック対角の問題を一つの行列にする(結合制約が先頭の行)
+tuple<Matrix, Vector, Vector> flatten_block_angular(const std::vector<Block<double> > &blocks, const Vector &d) {
+  int m0 = d.getSize();
+  int M = m0, N = 0;
+  for (size_t k = 0; k < blocks.size(); k++) {
+    M += blocks[k].b.getSize();
+    N += blocks[k].c.getSize();
   }
-  Matrix Sub(m+1, n+m+cnt+1);
-  for (int i = 0; i < Sub.getRow(); i++) {
-    for (int j = 0; j < Sub.getCol(); j++) {
-      if (i < m && j < n) Sub[i][j] = A[i][j];
-      else if (i < m && j >= n && j < n+m) Sub[i][j] = (j-n == i) ? 1 : 0;
-      else if (i < m && j == n+m+cnt) Sub[i][j] = b[i];
-      else if (i == m && j < n+m) Sub[i][j] = 0;
-      else if (i == m && j >= n+m  && j < n+m+cnt) Sub[i][j] = 1;
-      else if (i == m && j == n+m+cnt) Sub[i][j] = 0;
-    }
+  Matrix A(M, N);
+  Vector b(M), c(N);
+  for (int i = 0; i < m0; i++) {
+    b[i] = d[i];
   }
-
-  int flag = 0;
-  for (int i = 0; i < m; i++) {
-    if (b[i] < 0) {
-      Sub[i][n+m+flag] = -1;
-      flag++;
-      Sub[i] = -Sub[i];
-      Sub[m] -= Sub[i];
+  for (size_t k = 0, row = m0, col = 0; k < blocks.size(); k++) {
+    const Block<double> &block = blocks[k];
+    int mk = block.b.getSize();
+    int nk = block.c.getSize();
+    for (int j = 0; j < nk; j++) {
+      c[col+j] = block.c[j];
+      for (int i = 0; i < m0; i++) {
+        A[i][col+j] = block.D[i][j];
+      }
+      for (int i = 0; i < mk; i++) {
+        A[row+i][col+j] = block.B[i][j];
+      }
     }
-  }
-
-  Vector C(Sub.getCol());
-  for (int i = 0; i < Sub.getCol(); i++) {
-    if (i < n) C[i] = -c[i];
-    else C[i] = 0;
-  }
-
-  simplexMethod2(Sub, C);
-
-  if (Sub[m][n+m+cnt] < 0) {
-    cout << "Sub problem" << endl;
-    cout << Sub;
-    throw "infeasible";
-  };
-  
-  Matrix Main(m+1, n+m+1);
-  // 一番右の行
-  for (int i = 0; i < m+1; i++) {
-    if (i != m) Main[i][n+m] = Sub[i][n+m+cnt];
-    else if (i == m) Main[i][n+m] = C[n+m+cnt];
-  }
-  // それ以外
-  for (int i = 0; i < m+1; i++) {
-    for (int j = 0; j < n+m; j++) {
-      if (i != m) Main[i][j] = Sub[i][j];
-      else if (i == m) Main[i][j] = C[j];
+    for (int i = 0; i < mk; i++) {
+      b[row+i] = block.b[i];
     }
+    row += mk;
+    col += nk;
   }
-
-  return Main;
-}
-
-// 入力行列を作る(bに負の要素がある場合はそれを考慮して人工変数を入れる)
-Matrix createMatrix(const Matrix &A, const Vector &b, const Vector &c) {
-  int m = b.getSize();
-  int n = c.getSize();
-  Matrix All(m+1, n+m+1);
-  for (int i = 0; i < m+1; i++) {
-    for (int j = 0; j < n+m+1; j++) {
-      if (i < m && j < n) All[i][j] = A[i][j];
-      else if (i < m && j >= n && j < n+m) All[i][j] = (j-n == i) ? 1 : 0;
-      else if (i < m && j == n+m) All[i][j] = b[i];
-      else if (i == m && j < n) All[i][j] = -c[j];
-      else if (i == m && j >= n) All[i][j] = 0;
-    }
-  }
-  return All;
+  return make_tuple(A, b, c);
 }
 
-// 結果出力
-void showResult(const Matrix &All) {
-  int m = All.getRow() - 1;
-  int n = All.getCol() - 1 - m;
-  Vector X(n);
-  for (int i = 0; i < m; i++) {
-    for (int j = 0; j < n; j++) {
-      if (All[i][j]  == 1.0) {
-        X[j] = All[i][n+m];
+// 素朴な三重ループによる行列積(GEMMの比較用)
+Matrix naiveProduct(const Matrix &left, const Matrix &right) {
+  Matrix m(left.getRow(), right.getCol());
+  for (int i = 0; i < left.getRow(); i++) {
+    for (int j = 0; j < right.getCol(); j++) {
+      double sum = 0.0;
+      for (int k = 0; k < left.getCol(); k++) {
+        sum += left[i][k] * right[k][j];
       }
+      m[i][j] = sum;
     }
   }
-  cout << "X: " << X;
-  cout << "f: " << All[m][n+m] << endl;
+  m.cleanup();
+  return m;
 }
 
 int main() {
@@ -446,8 +308,8 @@ int main() {
       Vector b = get<1>(tupleValue);
       Vector c = get<2>(tupleValue);
       auto start = std::chrono::high_resolution_clock::now();
-      Matrix All = subProblem(A, b, c);
-      simplexMethod(All);
+      Matrix All;
+      if (subProblem(A, b, c, All) == SOLVE_OPTIMAL) simplexMethod(All);
       auto end = std::chrono::high_resolution_clock::now();
       double elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
       T += elapsed;
@@ -466,8 +328,8 @@ int main() {
       Vector b = get<1>(tupleValue);
       Vector c = get<2>(tupleValue);
       auto start = std::chrono::high_resolution_clock::now();
-      Matrix All = subProblem(A, b, c);
-      simplexMethod(All);
+      Matrix All;
+      if (subProblem(A, b, c, All) == SOLVE_OPTIMAL) simplexMethod(All);
       auto end = std::chrono::high_resolution_clock::now();
       double elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
       T += elapsed;
@@ -488,11 +350,21 @@ int main() {
     cout << b;
     cout << "c" << endl;
     cout << c;
-    Matrix All = subProblem(A, b, c);
-    try {
-      simplexMethod(All);
-    } catch (char const* str) {
-      cout << str << endl;
+    Matrix All;
+    Basis basis;
+    SimplexOptions<double> opt;
+    SimplexResult<double> result;
+    if (subProblem(A, b, c, All, basis, opt, &result) == SOLVE_OPTIMAL) {
+      simplexMethod(All, basis, opt, &result);
+    }
+    if (result.status == SOLVE_UNBOUNDED) {
+      // Ad \leq 0, c^Td > 0 の方向
+      cout << "unbounded" << endl;
+      cout << "ray" << endl;
+      cout << result.ray;
+      cout << "Ad" << endl;
+      cout << A * result.ray;
+      cout << "c^Td: " << c * result.ray << endl;
     }
   }
 
@@ -508,10 +380,566 @@ int main() {
     cout << b;
     cout << "c" << endl;
     cout << c;
-    try {
-      Matrix All = subProblem(A, b, c);
-    } catch (char const* str) {
-      cout << str << endl;
+    Matrix All;
+    Basis basis;
+    SimplexOptions<double> opt;
+    SimplexResult<double> result;
+    if (subProblem(A, b, c, All, basis, opt, &result) == SOLVE_INFEASIBLE) {
+      // y \geq 0, y^TA \geq 0, y^Tb < 0 なので Ax \leq b, x \geq 0 は解を持たない
+      cout << "infeasible" << endl;
+      cout << "farkas" << endl;
+      cout << result.farkas;
+      cout << "y^TA" << endl;
+      cout << result.farkas * A;
+      cout << "y^Tb: " << result.farkas * b << endl;
+    }
+  }
+
+  cout << "(v)-gemm" << endl;
+  for (int i = 1; i <= 5; i++) {
+    int N = 128 * i;
+    Matrix A = randn(N, N);
+    Matrix B = randn(N, N);
+    double flop = 2.0 * N * N * N;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    Matrix C1 = naiveProduct(A, B);
+    auto end = std::chrono::high_resolution_clock::now();
+    double naive = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+
+    start = std::chrono::high_resolution_clock::now();
+    Matrix C2 = A * B;
+    end = std::chrono::high_resolution_clock::now();
+    double blocked = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+
+    cout << "m: " << N << " n: " << N << " k: " << N
+         << " naive: " << flop / naive * 1e-3 << " [GFLOP/s]"
+         << " blocked: " << flop / blocked * 1e-3 << " [GFLOP/s]"
+         << ((C1 == C2) ? "" : " (mismatch)") << endl;
+  }
+
+  cout << "(vi)-small" << endl;
+  {
+    // 定数式でも解ける: max x + y s.t. x \leq 1, y \leq 2
+    constexpr FixedResult<2> r = fixedSolve<2, 2, double>({{{1, 0}, {0, 1}}}, {1, 2}, {1, 1});
+    static_assert(r.status == FIXED_OPTIMAL && r.f == 3, "fixedSolve in a constant expression");
+
+    const int sizes[][2] = {{2, 3}, {3, 3}, {4, 4}, {6, 6}};
+    const int count = 10000;
+    for (int k = 0; k < 4; k++) {
+      int m = sizes[k][0], n = sizes[k][1];
+      std::vector<tuple<Matrix, Vector, Vector> > problems;
+      for (int j = 0; j < count; j++) {
+        problems.push_back(create_feasible_bounded_problem(m, n, true));
+      }
+      Vector x(n);
+      double f = 0.0;
+
+      auto start = std::chrono::high_resolution_clock::now();
+      for (int j = 0; j < count; j++) {
+        Matrix All = createMatrix(get<0>(problems[j]), get<1>(problems[j]), get<2>(problems[j]));
+        simplexMethod(All);
+      }
+      auto end = std::chrono::high_resolution_clock::now();
+      double dynamic = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+
+      start = std::chrono::high_resolution_clock::now();
+      for (int j = 0; j < count; j++) {
+        solveLP(get<0>(problems[j]), get<1>(problems[j]), get<2>(problems[j]), x, f);
+      }
+      end = std::chrono::high_resolution_clock::now();
+      double fixed = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+
+      cout << "m: " << m << " n: " << n
+           << " dynamic: " << count / dynamic * 1e6 << " [solves/s]"
+           << " fixed: " << count / fixed * 1e6 << " [solves/s]" << endl;
+    }
+  }
+
+  cout << "(vii)-interior point" << endl;
+  for (int i = 1; i <= 4; i++) {
+    // 時間は問題ごとのばらつきが大きいので別々の問題trials個の平均. ipm + crossoverは
+    // 基底解までの時間で, simplexと比べるのはこちら. f diffはその最大の相対差
+    int trials = i <= 2 ? 10 : (i == 3 ? 3 : 1);
+    double ipm = 0, xo = 0, simplex = 0, diff = 0;
+    int iterations = 0;
+    for (int t = 0; t < trials; t++) {
+      tuple<Matrix, Vector, Vector> tupleValue = create_feasible_bounded_problem(pow(10, i), 10, true);
+      Matrix A = get<0>(tupleValue);
+      Vector b = get<1>(tupleValue);
+      Vector c = get<2>(tupleValue);
+      auto start = std::chrono::high_resolution_clock::now();
+      IPMResult<double> r = interiorPointMethod(A, b, c);
+      auto end = std::chrono::high_resolution_clock::now();
+      ipm += std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+      iterations += r.iterations;
+      if (i <= 3) {
+        start = std::chrono::high_resolution_clock::now();
+        Matrix X;
+        crossover(A, b, c, r, X);
+        end = std::chrono::high_resolution_clock::now();
+        xo += std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+        start = std::chrono::high_resolution_clock::now();
+        Matrix All = createMatrix(A, b, c);
+        simplexMethod(All);
+        end = std::chrono::high_resolution_clock::now();
+        simplex += std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+        int m = A.getRow();
+        double f = All[m][All.getCol()-1];
+        diff = std::max(diff, std::fabs(X[m][X.getCol()-1] - f) / (1 + std::fabs(f)));
+      }
+    }
+    cout << "m: 10^" << i << " n: 10" << " ipm: " << ipm / trials << " [μs]"
+         << " iterations: " << (double)iterations / trials;
+    if (i <= 3) {
+      cout << " crossover: " << xo / trials << " [μs] ipm + crossover: " << (ipm + xo) / trials
+           << " [μs] simplex: " << simplex / trials << " [μs] f diff: " << diff;
+    }
+    cout << endl;
+  }
+  for (int i = 1; i <= 5; i++) {
+    tuple<Matrix, Vector, Vector> tupleValue = create_feasible_bounded_problem(10, pow(10, i), true);
+    Matrix A = get<0>(tupleValue);
+    Vector b = get<1>(tupleValue);
+    Vector c = get<2>(tupleValue);
+    auto start = std::chrono::high_resolution_clock::now();
+    IPMResult<double> r = interiorPointMethod(A, b, c);
+    auto end = std::chrono::high_resolution_clock::now();
+    double ipm = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+    cout << "m: 10" << " n: 10^" << i << " ipm: " << ipm << " [μs]"
+         << " iterations: " << r.iterations << " f: " << r.f << endl;
+  }
+
+  cout << "(viii)-degenerate" << endl;
+  {
+    // Bealeの例: 最大係数規則だけでは同じ基底の列を巡回し続ける
+    Matrix A(3, 4);
+    Vector b(3), c(4);
+    double a[3][4] = {{0.25, -8, -1, 9}, {0.5, -12, -0.5, 3}, {0, 0, 1, 0}};
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 4; j++) {
+        A[i][j] = a[i][j];
+      }
+    }
+    b[2] = 1;
+    c[0] = 0.75; c[1] = -20; c[2] = 0.5; c[3] = -6;
+    const int limits[] = {50, 5};
+    for (int k = 0; k < 2; k++) {
+      Basis basis;
+      Matrix All = createMatrix(A, b, c, basis);
+      SimplexOptions<double> opt;
+      opt.stallLimit = limits[k];
+      SimplexResult<double> result;
+      simplexMethod(All, basis, opt, &result);
+      const SimplexStats &stats = result.stats;
+      cout << "stallLimit: " << limits[k] << " f: " << All[3][7]
+           << " iterations: " << stats.iterations
+           << " degenerate: " << stats.degeneratePivots
+           << " longest stall: " << stats.longestStall
+           << " perturbations: " << stats.perturbations
+           << " bland: " << stats.blandPivots << endl;
+    }
+  }
+
+  cout << "(ix)-column generation" << endl;
+  {
+    // 列jは種jの乱数から作る(a_j \in [0, 1)^m, c_j \in [0, 1)). 価格付けは
+    // 全ての列を作り直しながら被約費用の大きい列を返し, 列は保存しない
+    const int m = 20;
+    const int K = 10;
+    auto column = [](int j) {
+      std::minstd_rand mt(j + 1);
+      uniform_real_distribution<double> u(0.0, 1.0);
+      Column<double> col = {Vector(m), 0.0};
+      for (int i = 0; i < m; i++) {
+        col.a[i] = u(mt);
+      }
+      col.c = u(mt);
+      return col;
+    };
+    Vector b(m);
+    for (int i = 0; i < m; i++) {
+      b[i] = 1;
+    }
+    for (int i = 3; i <= 5; i++) {
+      int N = pow(10, i);
+      PricingOracle<double> price = [&](const Vector &y, std::vector<Column<double> > &columns) {
+        std::vector<std::pair<double, int> > best;
+        for (int j = 0; j < N; j++) {
+          Column<double> col = column(j);
+          double d = col.c - col.a * y;
+          if (d > 1e-9) best.push_back(std::make_pair(d, j));
+        }
+        int k = min(K, (int)best.size());
+        std::partial_sort(best.begin(), best.begin() + k, best.end(),
+                          [](const std::pair<double, int> &p, const std::pair<double, int> &q) {
+                            return p.first > q.first;
+                          });
+        for (int q = 0; q < k; q++) {
+          columns.push_back(column(best[q].second));
+        }
+      };
+
+      auto start = std::chrono::high_resolution_clock::now();
+      Matrix A0(m, 1);
+      Vector c0(1);
+      Column<double> first = column(0);
+      for (int r = 0; r < m; r++) {
+        A0[r][0] = first.a[r];
+      }
+      c0[0] = first.c;
+      Basis basis;
+      Matrix All = createMatrix(A0, b, c0, basis);
+      PricingStats stats;
+      columnGeneration(All, basis, price, SimplexOptions<double>(), (SimplexResult<double> *)0, &stats);
+      auto end = std::chrono::high_resolution_clock::now();
+      double cg = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+
+      start = std::chrono::high_resolution_clock::now();
+      Matrix A(m, N);
+      Vector c(N);
+      for (int j = 0; j < N; j++) {
+        Column<double> col = column(j);
+        for (int r = 0; r < m; r++) {
+          A[r][j] = col.a[r];
+        }
+        c[j] = col.c;
+      }
+      Matrix Full = createMatrix(A, b, c);
+      simplexMethod(Full);
+      end = std::chrono::high_resolution_clock::now();
+      double full = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+
+      cout << "m: " << m << " n: 10^" << i
+           << " column generation: " << cg << " [μs] rounds: " << stats.rounds
+           << " columns: " << stats.columns + 1 << " f: " << All[m][All.getCol()-1]
+           << " full: " << full << " [μs] f: " << Full[m][N+m] << endl;
+    }
+  }
+
+  cout << "(x)-cutting planes" << endl;
+  {
+    // 解いた表に最適解を切るk本の制約 a^Tx \leq 0.9 a^Tx* を加えて双対単体法で
+    // 解き直す場合(warm)と, 最初から解き直す場合(cold)
+    const int m = 200, n = 100;
+    tuple<Matrix, Vector, Vector> tupleValue = create_feasible_bounded_problem(m, n, true);
+    Matrix A = get<0>(tupleValue);
+    Vector b = get<1>(tupleValue);
+    Vector c = get<2>(tupleValue);
+    Basis basis;
+    Matrix All = createMatrix(A, b, c, basis);
+    simplexMethod(All, basis);
+    Vector x = getSolution(All, basis).x;
+    for (int k = 1; k <= 100; k *= 10) {
+      Matrix C(k, n);
+      Vector d(k);
+      for (int q = 0; q < k; q++) {
+        C[q] = rand(n);
+        d[q] = 0.9 * (C[q] * x);
+      }
+
+      Matrix Warm = All;
+      Basis warmBasis = basis;
+      auto start = std::chrono::high_resolution_clock::now();
+      addRows(Warm, warmBasis, C, d);
+      auto end = std::chrono::high_resolution_clock::now();
+      double warm = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+
+      start = std::chrono::high_resolution_clock::now();
+      Matrix A2(m+k, n);
+      Vector b2(m+k);
+      for (int i = 0; i < m+k; i++) {
+        A2[i] = i < m ? A[i] : C[i-m];
+        b2[i] = i < m ? b[i] : d[i-m];
+      }
+      Matrix Cold = createMatrix(A2, b2, c);
+      simplexMethod(Cold);
+      end = std::chrono::high_resolution_clock::now();
+      double cold = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+
+      cout << "m: " << m << " n: " << n << " k: " << k
+           << " warm: " << warm << " [μs] f: " << Warm[m+k][n+m+k]
+           << " cold: " << cold << " [μs] f: " << Cold[m+k][n+m+k] << endl;
+    }
+  }
+
+  cout << "(xi)-branch and bound" << endl;
+  {
+    // 0 \leq A, b = 0.5 * (行和) のナップサック型の整数計画. スレッド数ごとの節点の処理速度
+    const int m = 15, n = 30;
+    std::mt19937 mt(36);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    Matrix A(m, n);
+    Vector b(m);
+    Vector c(n);
+    for (int i = 0; i < m; i++) {
+      for (int j = 0; j < n; j++) {
+        A[i][j] = uniform(mt);
+        b[i] += 0.5 * A[i][j];
+      }
+    }
+    for (int j = 0; j < n; j++) {
+      c[j] = uniform(mt);
+    }
+    std::vector<bool> integer(n, true);
+    for (int s = 0; s < 2; s++) {
+      for (int threads = 1; threads <= 4; threads *= 2) {
+        MIPOptions<double> opt;
+        opt.selection = s == 0 ? MIP_BEST_BOUND : MIP_DEPTH_FIRST;
+        opt.threads = threads;
+        auto start = std::chrono::high_resolution_clock::now();
+        MIPResult<double> r = branchAndBound(A, b, c, integer, opt);
+        auto end = std::chrono::high_resolution_clock::now();
+        double time = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+
+        cout << "m: " << m << " n: " << n
+             << (s == 0 ? " best bound" : " depth first") << " threads: " << threads
+             << " time: " << time << " [μs] nodes: " << r.nodes
+             << " nodes/s: " << r.nodes / time * 1e6 << " f: " << r.f << endl;
+      }
+    }
+  }
+
+  cout << "(xii)-strategy race" << endl;
+  {
+    // 縦長, 横長, bに負の要素がある問題, 行の大きさがばらばらの問題について,
+    // 各戦略を一つずつ解いた時間と, 全ての戦略を競わせた時間と勝者
+    std::vector<Strategy> strategies = defaultStrategies();
+    RaceStats stats;
+    std::mt19937 mt(37);
+    std::uniform_real_distribution<double> exponent(-3, 3);
+    const int shapes[4][2] = {{400, 50}, {50, 400}, {200, 200}, {200, 200}};
+    const char *names[4] = {"tall", "wide", "negative b", "badly scaled"};
+    for (int k = 0; k < 4; k++) {
+      int m = shapes[k][0], n = shapes[k][1];
+      tuple<Matrix, Vector, Vector> tupleValue = create_feasible_bounded_problem(m, n, k != 2);
+      Matrix A = get<0>(tupleValue);
+      Vector b = get<1>(tupleValue);
+      Vector c = get<2>(tupleValue);
+      if (k == 3) {
+        for (int i = 0; i < m; i++) {
+          double scale = pow(10, exponent(mt));
+          A[i] = scale * A[i];
+          b[i] *= scale;
+        }
+      }
+      cout << names[k] << " m: " << m << " n: " << n << endl;
+      for (size_t s = 0; s < strategies.size(); s++) {
+        RaceResult<double> r = raceStrategies(A, b, c, std::vector<Strategy>(1, strategies[s]));
+        cout << "  " << strategyName(strategies[s]) << ": " << r.time << " [μs] iterations: "
+             << r.result.stats.iterations << " f: " << r.solution.f
+             << (r.verified ? "" : " (residual check failed)") << endl;
+      }
+      RaceResult<double> r = raceStrategies(A, b, c, strategies, SimplexOptions<double>(), &stats);
+      if (r.status == SOLVE_NUMERICAL) {
+        cout << "  race: " << r.time << " [μs] no answer passed the residual check" << endl;
+      } else {
+        cout << "  race: " << r.time << " [μs] winner: "
+             << (r.winner == -1 ? "primal fallback" : strategyName(strategies[r.winner]))
+             << " f: " << r.solution.f << endl;
+      }
+    }
+    cout << "wins:";
+    for (size_t s = 0; s < strategies.size(); s++) {
+      cout << " " << strategyName(strategies[s]) << " " << stats.wins[s] << ";";
+    }
+    cout << endl;
+  }
+
+  cout << "(xiii)-budgets and progress" << endl;
+  {
+    // 50 [ms]ずつの予算で止めては続きから解き直し, 一度に解いた場合と比べる.
+    // 予算と進捗は25ピボットごとに確かめる
+    const int m = 300, n = 300;
+    tuple<Matrix, Vector, Vector> tupleValue = create_feasible_bounded_problem(m, n, false);
+    Matrix A = get<0>(tupleValue);
+    Vector b = get<1>(tupleValue);
+    Vector c = get<2>(tupleValue);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    Matrix Once;
+    Basis onceBasis;
+    SolveStatus status = subProblem(A, b, c, Once, onceBasis);
+    if (status == SOLVE_OPTIMAL) simplexMethod(Once, onceBasis);
+    auto end = std::chrono::high_resolution_clock::now();
+    double once = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+
+    SimplexOptions<double> opt;
+    opt.timeLimit = 0.05;
+    opt.checkEvery = 25;
+    opt.progress = [](const SimplexProgress<double> &p) {
+      cout << "  iterations: " << p.iterations << " objective: " << p.objective
+           << " infeasibility: " << p.infeasibility << " elapsed: " << p.elapsed << " [s]" << endl;
+    };
+    start = std::chrono::high_resolution_clock::now();
+    Matrix All;
+    Basis basis;
+    SimplexResult<double> result;
+    int calls = 1;
+    status = subProblem(A, b, c, All, basis, opt, &result);
+    while (status == SOLVE_TIME_LIMIT) {
+      status = resume(All, basis, n, opt, &result);
+      calls++;
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double sliced = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+
+    cout << "m: " << m << " n: " << n << " once: " << once << " [μs] f: " << Once[m][n+m]
+         << " 50 [ms] slices: " << sliced << " [μs] calls: " << calls
+         << " iterations: " << result.stats.iterations << " f: " << All[m][n+m] << endl;
+  }
+
+  cout << "(xiv)-mixed precision" << endl;
+  {
+    // (ii)の大きさで, doubleの表で解いた時間とfloatの表でピボットしてdoubleで
+    // 改良した時間. f diffは相対差, residualは改良した解の主と双対の残差の大きい方
+    const char *paths[3] = {"refined", "warm", "cold"};
+    for (int k = 0; k < 11; k++) {
+      int m = k < 7 ? 10 : pow(10, k-6);
+      int n = k < 7 ? pow(10, k+1) : 10;
+      tuple<Matrix, Vector, Vector> tupleValue = create_feasible_bounded_problem(m, n, true);
+      Matrix A = get<0>(tupleValue);
+      Vector b = get<1>(tupleValue);
+      Vector c = get<2>(tupleValue);
+      auto start = std::chrono::high_resolution_clock::now();
+      double f;
+      {
+        Matrix All = createMatrix(A, b, c);
+        simplexMethod(All);
+        f = All[m][n+m];
+      }
+      auto end = std::chrono::high_resolution_clock::now();
+      double plain = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+
+      start = std::chrono::high_resolution_clock::now();
+      MixedResult<double> r = mixedPrecisionSolve(A, b, c);
+      end = std::chrono::high_resolution_clock::now();
+      double mixed = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+
+      cout << "m: " << m << " n: " << n << " double: " << plain << " [μs] mixed: " << mixed
+           << " [μs] (float: " << r.lowTime << " refine: " << r.highTime << ") " << paths[r.path]
+           << " iterations: " << r.lowIterations << "+" << r.highIterations
+           << " f diff: " << std::fabs(r.solution.f - f) / (1 + std::fabs(f))
+           << " residual: " << max(r.primalResidual, r.dualResidual) << endl;
+    }
+  }
+  // (xv)
+  cout << "(xv)-mapped tableau" << endl;
+  {
+    // (ii)の大きさで, メモリ上の表とファイルに写像した表(ピボットごとに全パネルを
+    // 読み書きし, 読み終えたページは手放す)で解いた時間. streamは写像した表の
+    // (ピボットの回数+1) x ファイルの大きさ / 時間
+    for (int k = 0; k < 11; k++) {
+      int m = k < 7 ? 10 : pow(10, k-6);
+      int n = k < 7 ? pow(10, k+1) : 10;
+      tuple<Matrix, Vector, Vector> tupleValue = create_feasible_bounded_problem(m, n, true);
+      Matrix A = get<0>(tupleValue);
+      Vector b = get<1>(tupleValue);
+      Vector c = get<2>(tupleValue);
+      auto start = std::chrono::high_resolution_clock::now();
+      double f;
+      {
+        Matrix All = createMatrix(A, b, c);
+        simplexMethod(All);
+        f = All[m][n+m];
+      }
+      auto end = std::chrono::high_resolution_clock::now();
+      double memory = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+
+      start = std::chrono::high_resolution_clock::now();
+      MappedTableau<double> Mapped(m, n);
+      Basis basis;
+      SimplexResult<double> r;
+      createMatrix(A, b, c, Mapped, basis);
+      simplexMethod(Mapped, basis, SimplexOptions<double>(), &r);
+      end = std::chrono::high_resolution_clock::now();
+      double mapped = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+
+      double mb = Mapped.bytes() / 1e6;
+      cout << "m: " << m << " n: " << n << " memory: " << memory << " [μs] mapped: " << mapped
+           << " [μs] file: " << mb << " [MB] panels: " << Mapped.getPanels()
+           << " iterations: " << r.stats.iterations
+           << " stream: " << (r.stats.iterations + 1) * mb / mapped * 1e3 << " [GB/s]"
+           << " f diff: " << std::fabs(getSolution(Mapped, basis).f - f) / (1 + std::fabs(f)) << endl;
+    }
+  }
+  // (xvi)
+  cout << "(xvi)-crash" << endl;
+  {
+    // bに負の要素がある問題(10問の平均)をクラッシュなしとLTSF風のクラッシュから
+    // 解く. crashはクラッシュのピボット, phase 1は第一段階のピボット
+    const char *names[2] = {"none", "ltsf"};
+    const CrashRule rules[2] = {CRASH_NONE, CRASH_LTSF};
+    const int sizes[8][2] = {{10, 10}, {10, 30}, {10, 50}, {30, 10}, {50, 10}, {100, 100}, {200, 200}, {400, 100}};
+    for (int k = 0; k < 8; k++) {
+      int m = sizes[k][0];
+      int n = sizes[k][1];
+      std::vector<tuple<Matrix, Vector, Vector> > problems;
+      for (int j = 0; j < 10; j++) {
+        problems.push_back(create_feasible_bounded_problem(m, n, false));
+      }
+      for (int q = 0; q < 2; q++) {
+        double T = 0.0, crash = 0.0, phase1 = 0.0, total = 0.0;
+        for (int j = 0; j < 10; j++) {
+          Matrix A = get<0>(problems[j]);
+          Vector b = get<1>(problems[j]);
+          Vector c = get<2>(problems[j]);
+          auto start = std::chrono::high_resolution_clock::now();
+          Matrix All;
+          Basis basis;
+          SimplexOptions<double> opt;
+          opt.crash = rules[q];
+          SimplexResult<double> result;
+          if (subProblem(A, b, c, All, basis, opt, &result) == SOLVE_OPTIMAL) {
+            phase1 += result.stats.iterations;
+            simplexMethod(All, basis, opt, &result);
+          }
+          auto end = std::chrono::high_resolution_clock::now();
+          T += std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+          crash += result.stats.crashPivots;
+          total += result.stats.iterations;
+        }
+        cout << "m: " << m << " n: " << n << " " << names[q] << " crash: " << crash/10
+             << " phase 1: " << phase1/10 << " iterations: " << total/10 << " time: " << T/10 << " [μs]" << endl;
+      }
+    }
+  }
+  // (xvii)
+  cout << "(xvii)-Dantzig-Wolfe" << endl;
+  {
+    // 40 x 40 のブロックK個を10本の結合制約でつないだ問題をスレッド数を変えて
+    // 分解法で解いた時間(価格付けは全ブロックを並列に解く). fullは一つの表で
+    // 解いた時間(K \leq 32), f diffはその最適値との相対差
+    const int m0 = 10, mk = 40, nk = 40;
+    int cores = std::max(1, (int)std::thread::hardware_concurrency());
+    for (int K = 8; K <= 128; K *= 4) {
+      tuple<std::vector<Block<double> >, Vector> problem = create_block_angular_problem(K, mk, nk, m0);
+      std::vector<Block<double> > &blocks = get<0>(problem);
+      Vector &d = get<1>(problem);
+      double f = 0, full = 0;
+      if (K <= 32) {
+        tuple<Matrix, Vector, Vector> tupleValue = flatten_block_angular(blocks, d);
+        auto start = std::chrono::high_resolution_clock::now();
+        Matrix All = createMatrix(get<0>(tupleValue), get<1>(tupleValue), get<2>(tupleValue));
+        simplexMethod(All);
+        auto end = std::chrono::high_resolution_clock::now();
+        full = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+        f = All[All.getRow()-1][All.getCol()-1];
+        cout << "K: " << K << " rows: " << All.getRow()-1 << " full: " << full << " [μs]" << endl;
+      }
+      for (int threads = 1; threads <= std::max(4, cores); threads *= 2) {
+        DecompositionOptions<double> opt;
+        opt.threads = threads;
+        auto start = std::chrono::high_resolution_clock::now();
+        DecompositionResult<double> r = dantzigWolfe(blocks, d, opt);
+        auto end = std::chrono::high_resolution_clock::now();
+        double elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+        cout << "K: " << K << " threads: " << threads << " time: " << elapsed << " [μs] (master: "
+             << r.masterTime << " pricing: " << r.pricingTime << ") rounds: " << r.rounds
+             << " columns: " << r.columns << " pivots: " << r.masterIterations << "+" << r.blockIterations;
+        if (K <= 32) cout << " f diff: " << std::fabs(r.f - f) / (1 + std::fabs(f));
+        cout << endl;
+      }
     }
   }
 }